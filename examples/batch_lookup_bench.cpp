@@ -0,0 +1,78 @@
+// lookup throughput of HashMap and FlatHashMap on tables much larger than
+// the last level cache: one find() per key against get_many() over the
+// same keys, which prefetches a whole batch before resolving it.
+//
+//   batch_lookup_bench [entries]
+//
+// half of the looked up keys are present. the default is 8M entries,
+// a few hundred MB per table.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../src/hash.h"
+#include "../src/swiss_table.h"
+
+template <typename F>
+double seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Map>
+void run(const char* name, const Map& map, const std::vector<uint64_t>& probes) {
+  std::vector<const uint64_t*> out(probes.size());
+  size_t scalar_hits = 0;
+  double scalar = seconds([&]() {
+    for (size_t i = 0; i < probes.size(); i++) {
+      out[i] = map.find(probes[i]);
+      scalar_hits += out[i] != nullptr;
+    }
+  });
+  size_t batch_hits = 0;
+  double batched = seconds([&]() {
+    map.get_many(probes, out);
+    for (const uint64_t* value : out) {
+      batch_hits += value != nullptr;
+    }
+  });
+  if (scalar_hits != batch_hits) {
+    std::fprintf(stderr, "%s: %zu hits with find, %zu with get_many\n", name, scalar_hits, batch_hits);
+  }
+  double ops = static_cast<double>(probes.size()) / 1e6;
+  std::printf("  %-12s find %7.2f Mops/s   get_many %7.2f Mops/s   %.2fx\n", name, ops / scalar, ops / batched,
+    scalar / batched);
+}
+
+int main(int argc, char const* argv[]) {
+  size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 23;
+  std::mt19937_64 rng(7);
+  std::vector<uint64_t> keys(entries);
+  for (uint64_t& key : keys) {
+    key = rng() | 1;
+  }
+  // even keys are never inserted
+  std::vector<uint64_t> probes(entries);
+  for (size_t i = 0; i < probes.size(); i++) {
+    probes[i] = i % 2 == 0 ? keys[rng() % entries] : rng() & ~uint64_t(1);
+  }
+  std::printf("%zu entries, %zu lookups\n", entries, probes.size());
+
+  {
+    auto map = dsun::HashMap<uint64_t, uint64_t>::with_capacity(entries);
+    for (uint64_t key : keys) {
+      map.insert(key, key);
+    }
+    run("HashMap", map, probes);
+  }
+  {
+    SwissTables::FlatHashMap<uint64_t, uint64_t> map(entries * 2);
+    for (uint64_t key : keys) {
+      map.insert(key, key);
+    }
+    run("FlatHashMap", map, probes);
+  }
+  return 0;
+}
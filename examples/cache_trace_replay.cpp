@@ -0,0 +1,115 @@
+// replays a key trace against the cache policies and prints hit ratios
+// and throughput.
+//
+//   cache_trace_replay [trace_file]
+//
+// the trace file holds whitespace separated integer keys. without one, a
+// synthetic zipfian trace mixed with one-off scans is generated.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/cache.h"
+
+std::vector<uint64_t> load_trace(const char* path) {
+  std::vector<uint64_t> trace;
+  std::ifstream file(path);
+  uint64_t key;
+  while (file >> key) {
+    trace.push_back(key);
+  }
+  return trace;
+}
+
+// zipf(0.99) over `keys` keys, with every tenth request replaced by a key
+// that is never requested again
+std::vector<uint64_t> synthetic_trace(size_t requests, size_t keys) {
+  std::vector<double> cdf(keys);
+  double sum = 0;
+  for (size_t i = 0; i < keys; i++) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+    cdf[i] = sum;
+  }
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> uniform(0, sum);
+  std::vector<uint64_t> trace;
+  trace.reserve(requests);
+  uint64_t one_off = keys;
+  for (size_t i = 0; i < requests; i++) {
+    if (i % 10 == 9) {
+      trace.push_back(one_off++);
+      continue;
+    }
+    auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng));
+    trace.push_back(static_cast<uint64_t>(it - cdf.begin()));
+  }
+  return trace;
+}
+
+template <typename Policy>
+void replay(const char* name, const std::vector<uint64_t>& trace, size_t capacity) {
+  dsun::Cache<uint64_t, uint64_t, Policy> cache(capacity);
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t key : trace) {
+    if (!cache.get(key).has_value()) {
+      cache.put(key, key);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto stats = cache.stats();
+  std::printf("  %-8s hit ratio %6.2f%%  evictions %10llu  %8.2f Mops/s\n", name, stats.hit_ratio() * 100,
+    static_cast<unsigned long long>(stats.evictions), static_cast<double>(trace.size()) / elapsed / 1e6);
+}
+
+template <typename Policy>
+void replay_sharded(const char* name, const std::vector<uint64_t>& trace, size_t capacity, size_t threads) {
+  dsun::ShardedCache<uint64_t, uint64_t, Policy, dsun::cache::EntryCount, 64> cache(capacity);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      for (size_t i = t; i < trace.size(); i += threads) {
+        if (!cache.get(trace[i]).has_value()) {
+          cache.put(trace[i], trace[i]);
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto stats = cache.stats();
+  std::printf("  %-8s %2zu threads  hit ratio %6.2f%%  %8.2f Mops/s\n", name, threads, stats.hit_ratio() * 100,
+    static_cast<double>(trace.size()) / elapsed / 1e6);
+}
+
+int main(int argc, char const* argv[]) {
+  const size_t key_space = 100000;
+  std::vector<uint64_t> trace = argc > 1 ? load_trace(argv[1]) : synthetic_trace(2000000, key_space);
+  if (trace.empty()) {
+    std::fprintf(stderr, "empty trace\n");
+    return 1;
+  }
+  std::printf("%zu requests\n", trace.size());
+
+  for (size_t capacity : { key_space / 100, key_space / 10 }) {
+    std::printf("capacity %zu\n", capacity);
+    replay<dsun::LRU>("LRU", trace, capacity);
+    replay<dsun::Clock>("CLOCK", trace, capacity);
+    replay<dsun::S3FIFO>("S3-FIFO", trace, capacity);
+  }
+
+  size_t max_threads = std::thread::hardware_concurrency();
+  std::printf("sharded, capacity %zu\n", key_space / 10);
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    replay_sharded<dsun::LRU>("LRU", trace, key_space / 10, threads);
+    replay_sharded<dsun::S3FIFO>("S3-FIFO", trace, key_space / 10, threads);
+  }
+  return 0;
+}
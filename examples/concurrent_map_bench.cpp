@@ -0,0 +1,101 @@
+// mixed read/write throughput of ConcurrentHashMap against a HashMap
+// behind a single mutex, from 1 to 64 threads.
+//
+//   concurrent_map_bench [read_percent]
+//
+// every thread runs the same number of operations on uniformly random keys
+// from a prefilled key space; read_percent (default 90) of them are gets,
+// the rest alternate between inserts and removes.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../src/concurrent_hash_map.h"
+
+const uint64_t kKeys = 1 << 16;
+const size_t kOpsPerThread = 500000;
+
+struct LockedMap {
+  std::mutex lock;
+  dsun::HashMap<uint64_t, uint64_t> map;
+
+  bool get(uint64_t key) {
+    std::lock_guard<std::mutex> guard(lock);
+    return map.find(key) != nullptr;
+  }
+  void insert(uint64_t key, uint64_t value) {
+    std::lock_guard<std::mutex> guard(lock);
+    map.insert(key, value);
+  }
+  void remove(uint64_t key) {
+    std::lock_guard<std::mutex> guard(lock);
+    map.remove(key);
+  }
+};
+
+struct ShardedMap {
+  dsun::ConcurrentHashMap<uint64_t, uint64_t> map;
+
+  bool get(uint64_t key) {
+    return map.get(key).has_value();
+  }
+  void insert(uint64_t key, uint64_t value) {
+    map.insert(key, value);
+  }
+  void remove(uint64_t key) {
+    map.remove(key);
+  }
+};
+
+template <typename Map>
+double run(size_t threads, int read_percent) {
+  Map map;
+  for (uint64_t key = 0; key < kKeys; key += 2) {
+    map.insert(key, key);
+  }
+  std::vector<std::thread> workers;
+  std::atomic<size_t> hits{ 0 };
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      std::mt19937_64 rng(t + 1);
+      size_t local_hits = 0;
+      for (size_t i = 0; i < kOpsPerThread; i++) {
+        uint64_t r = rng();
+        uint64_t key = r % kKeys;
+        if (static_cast<int>((r >> 32) % 100) < read_percent) {
+          local_hits += map.get(key);
+        }
+        else if ((r >> 40) & 1) {
+          map.insert(key, key);
+        }
+        else {
+          map.remove(key);
+        }
+      }
+      hits.fetch_add(local_hits);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(threads * kOpsPerThread) / elapsed / 1e6;
+}
+
+int main(int argc, char const* argv[]) {
+  int read_percent = argc > 1 ? std::atoi(argv[1]) : 90;
+  std::printf("%d%% reads, %llu keys, %zu ops per thread, %u hardware threads\n", read_percent,
+    static_cast<unsigned long long>(kKeys), kOpsPerThread, std::thread::hardware_concurrency());
+  std::printf("  threads   mutex Mops/s   sharded Mops/s\n");
+  for (size_t threads = 1; threads <= 64; threads *= 2) {
+    double locked = run<LockedMap>(threads, read_percent);
+    double sharded = run<ShardedMap>(threads, read_percent);
+    std::printf("  %7zu   %12.2f   %14.2f\n", threads, locked, sharded);
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+// probe throughput of FlatHashMap with each ctrl byte group: the portable
+// 8-byte SWAR group, SSE2 (16), AVX2 (32) and AVX-512 (64). groups the cpu
+// lacks are skipped.
+//
+//   group_width_bench [log2 capacity]
+//
+// every table has the same capacity (default 2^20 slots) and is measured
+// half full and at the 7/8 maximum load, once with keys that are all
+// present and once with keys that are all absent. a miss has to probe
+// until it reaches a group with an empty slot, so it shows most clearly
+// what a wider group saves at high load.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../src/swiss_table.h"
+
+using namespace SwissTables;
+
+template <typename Group>
+using Map = FlatHashMap<uint64_t, uint64_t, dsun::Hash<uint64_t>, Group>;
+
+template <typename F>
+double seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Group>
+size_t count_hits(const Map<Group>& map, const std::vector<uint64_t>& probes) {
+  size_t hits = 0;
+  for (uint64_t key : probes) {
+    hits += map.find(key) != nullptr;
+  }
+  return hits;
+}
+
+// the wide groups only inline into code compiled for their instruction set
+#if DSUN_SWISS_X86
+DSUN_SWISS_KERNEL("avx2") size_t count_hits_avx2(const Map<GroupAvx2>& map, const std::vector<uint64_t>& probes) {
+  return count_hits(map, probes);
+}
+DSUN_SWISS_KERNEL("avx512bw") size_t count_hits_avx512(const Map<GroupAvx512>& map, const std::vector<uint64_t>& probes) {
+  return count_hits(map, probes);
+}
+#endif
+
+template <typename Group>
+size_t lookup(const Map<Group>& map, const std::vector<uint64_t>& probes) {
+#if DSUN_SWISS_X86
+  if constexpr (std::is_same_v<Group, GroupAvx2>) {
+    return count_hits_avx2(map, probes);
+  }
+  else if constexpr (std::is_same_v<Group, GroupAvx512>) {
+    return count_hits_avx512(map, probes);
+  }
+  else
+#endif
+  {
+    return count_hits(map, probes);
+  }
+}
+
+template <typename Group>
+void run(const char* name, size_t capacity, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& absent) {
+  if (!Group::supported()) {
+    std::printf("  %-9s not supported by this cpu\n", name);
+    return;
+  }
+  for (size_t len : { capacity / 2, capacity - capacity / 8 }) {
+    Map<Group> map(capacity);
+    for (size_t i = 0; i < len; i++) {
+      map.insert(keys[i], keys[i]);
+    }
+    std::vector<uint64_t> present(keys.begin(), keys.begin() + len);
+    std::shuffle(present.begin(), present.end(), std::mt19937_64(len));
+    size_t hits = 0;
+    size_t false_hits = 0;
+    double hit_time = seconds([&]() {
+      hits = lookup(map, present);
+    });
+    double miss_time = seconds([&]() {
+      false_hits = lookup(map, absent);
+    });
+    if (hits != len || false_hits != 0) {
+      std::fprintf(stderr, "%s: %zu of %zu hits, %zu false hits\n", name, hits, len, false_hits);
+    }
+    std::printf("  %-9s load %.3f   hit %7.2f Mops/s   miss %7.2f Mops/s\n", name,
+      static_cast<double>(len) / static_cast<double>(capacity),
+      static_cast<double>(present.size()) / hit_time / 1e6, static_cast<double>(absent.size()) / miss_time / 1e6);
+  }
+}
+
+int main(int argc, char const* argv[]) {
+  size_t capacity = size_t(1) << (argc > 1 ? std::atoi(argv[1]) : 20);
+  std::mt19937_64 rng(11);
+  // odd keys go in, even keys are never inserted
+  std::vector<uint64_t> keys(capacity);
+  for (uint64_t& key : keys) {
+    key = rng() | 1;
+  }
+  std::vector<uint64_t> absent(capacity / 2);
+  for (uint64_t& key : absent) {
+    key = rng() & ~uint64_t(1);
+  }
+  std::printf("%zu slots, %zu misses per run\n", capacity, absent.size());
+  run<GroupPortable>("swar-8", capacity, keys, absent);
+#if DSUN_SWISS_X86
+  run<GroupSse2>("sse2-16", capacity, keys, absent);
+  run<GroupAvx2>("avx2-32", capacity, keys, absent);
+  run<GroupAvx512>("avx512-64", capacity, keys, absent);
+#endif
+  return 0;
+}
@@ -17,31 +17,38 @@ typedef dsun::HashMap<char, uint64_t> freq_table_t;
 freq_table_t build_freq_table(const std::string& input) {
   freq_table_t freq_table;
   for (char c : input) {
-    freq_table.entry(c).and_modify([&](uint64_t& freq) {
-      freq += 1;
-      }).or_insert(1);
+    freq_table.entry(c).or_insert(0) += 1;
   }
   return freq_table;
 }
 
 
+bool by_frequency(const huffman_node_t* a, const huffman_node_t* b) {
+  return a->value.frequency < b->value.frequency;
+}
+
+// merges `node` after every node with a lower or equal frequency
 void insert_in_order(dsun::LinkedList<huffman_node_t*>& nodes, huffman_node_t* node) {
-  for (int i = 0; i < nodes.len(); i++) {
-    if (node->value.frequency < nodes[i]->value.frequency) {
-      nodes.insert(i, node);
-      return;
-    }
+  dsun::LinkedList<huffman_node_t*> single;
+  single.push_back(node);
+  nodes.merge(single, by_frequency);
+}
+
+void print_nodes(const dsun::LinkedList<huffman_node_t*>& nodes) {
+  std::cout << "[";
+  for (auto node : nodes) {
+    std::cout << "{" << node->value.value << ", " << node->value.frequency << "}";
   }
-  nodes.push_back(node);
+  std::cout << "]" << nodes.len() << std::endl;
 }
 
 
 dsun::LinkedList<huffman_node_t*> build_huffman_nodes(freq_table_t& freq_table) {
   dsun::LinkedList<huffman_node_t*> nodes;
   for (auto entry : freq_table) {
-    huffman_node_t* node = new huffman_node_t(huffman_value_t(entry.first, entry.second));
-    insert_in_order(nodes, node);
+    nodes.push_back(new huffman_node_t(huffman_value_t(entry.first, entry.second)));
   }
+  nodes.sort(by_frequency);
   return nodes;
 }
 
@@ -71,22 +78,14 @@ void merge_two_by_two(dsun::LinkedList<huffman_node_t*>& nodes) {
     std::cout << "Root: " << root->value.frequency << std::endl;
 
     insert_in_order(nodes, root);
-    std::cout << "[";
-    for (int i = 0; i < nodes.len(); i++) {
-      std::cout << "{" << nodes[i]->value.value << ", " << nodes[i]->value.frequency << "}";
-    }
-    std::cout << "]" << nodes.len() << std::endl;
+    print_nodes(nodes);
   }
 }
 
 huffman_node_t* build_huffMan_tree(dsun::LinkedList<huffman_node_t*>& nodes) {
-  std::cout << "[";
-  for (int i = 0; i < nodes.len(); i++) {
-    std::cout << "{" << nodes[i]->value.value << ", " << nodes[i]->value.frequency << "}";
-  }
-  std::cout << "]" << nodes.len() << std::endl;
+  print_nodes(nodes);
   merge_two_by_two(nodes);
-  return nodes[0];
+  return nodes.front().value();
 }
 
 int main(int argc, char const* argv[]) {
@@ -0,0 +1,558 @@
+#ifndef DSUN_CACHE_H
+#define DSUN_CACHE_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include "hash.h"
+
+namespace dsun {
+
+  struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+
+    double hit_ratio() const {
+      uint64_t total = hits + misses;
+      return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+
+    CacheStats& operator+=(const CacheStats& other) {
+      hits += other.hits;
+      misses += other.misses;
+      insertions += other.insertions;
+      evictions += other.evictions;
+      return *this;
+    }
+  };
+
+  namespace cache {
+    // every entry weighs 1, so the capacity is an entry count
+    struct EntryCount {
+      template <typename K, typename V>
+      size_t operator()(const K&, const V&) const {
+        return 1;
+      }
+    };
+
+    // approximate footprint in bytes: the inline size of key and value plus
+    // the elements of anything that looks like a container (strings, vectors).
+    // the per-entry bookkeeping of the cache itself is not counted.
+    struct ByteSize {
+      template <typename T>
+      static size_t bytes(const T& value) {
+        if constexpr (requires { value.size(); typename T::value_type; }) {
+          return sizeof(T) + value.size() * sizeof(typename T::value_type);
+        }
+        else {
+          return sizeof(T);
+        }
+      }
+
+      template <typename K, typename V>
+      size_t operator()(const K& key, const V& value) const {
+        return bytes(key) + bytes(value);
+      }
+    };
+
+    // intrusive doubly linked queue over the cache nodes.
+    // push_front inserts at the head, back() is the oldest node.
+    template <typename Node>
+    class Queue {
+    private:
+      Node* head = nullptr;
+      Node* tail = nullptr;
+      size_t weight_ = 0;
+      size_t len_ = 0;
+    public:
+      void push_front(Node* node) {
+        node->prev = nullptr;
+        node->next = head;
+        if (head) {
+          head->prev = node;
+        }
+        else {
+          tail = node;
+        }
+        head = node;
+        weight_ += node->weight;
+        len_++;
+      }
+
+      void remove(Node* node) {
+        if (node->prev) {
+          node->prev->next = node->next;
+        }
+        else {
+          head = node->next;
+        }
+        if (node->next) {
+          node->next->prev = node->prev;
+        }
+        else {
+          tail = node->prev;
+        }
+        node->prev = nullptr;
+        node->next = nullptr;
+        weight_ -= node->weight;
+        len_--;
+      }
+
+      void reweigh(size_t old_weight, size_t new_weight) {
+        weight_ = weight_ - old_weight + new_weight;
+      }
+
+      Node* back() const {
+        return tail;
+      }
+      bool is_empty() const {
+        return len_ == 0;
+      }
+      size_t weight() const {
+        return weight_;
+      }
+      size_t len() const {
+        return len_;
+      }
+    };
+  }
+
+  // eviction policies. each one exposes a `State<Node>` that the cache
+  // drives through on_insert / on_hit / on_update / on_erase, and evict(),
+  // which unlinks and returns the next victim.
+
+  // least recently used: hits move the entry to the head of the queue
+  struct LRU {
+    template <typename Node>
+    class State {
+    private:
+      cache::Queue<Node> queue;
+    public:
+      explicit State(size_t) {}
+
+      void on_insert(Node* node) {
+        queue.push_front(node);
+      }
+      void on_hit(Node* node) {
+        queue.remove(node);
+        queue.push_front(node);
+      }
+      void on_update(Node*, size_t old_weight, size_t new_weight) {
+        queue.reweigh(old_weight, new_weight);
+      }
+      void on_erase(Node* node) {
+        queue.remove(node);
+      }
+      Node* evict() {
+        Node* victim = queue.back();
+        queue.remove(victim);
+        return victim;
+      }
+    };
+  };
+
+  // CLOCK (second chance): a hit only sets a reference bit, so reads never
+  // touch the queue links. the hand gives referenced entries another lap.
+  struct Clock {
+    template <typename Node>
+    class State {
+    private:
+      cache::Queue<Node> ring;
+    public:
+      explicit State(size_t) {}
+
+      void on_insert(Node* node) {
+        node->freq = 0;
+        ring.push_front(node);
+      }
+      void on_hit(Node* node) {
+        node->freq = 1;
+      }
+      void on_update(Node*, size_t old_weight, size_t new_weight) {
+        ring.reweigh(old_weight, new_weight);
+      }
+      void on_erase(Node* node) {
+        ring.remove(node);
+      }
+      Node* evict() {
+        while (true) {
+          Node* hand = ring.back();
+          ring.remove(hand);
+          if (hand->freq == 0) {
+            return hand;
+          }
+          hand->freq = 0;
+          ring.push_front(hand);
+        }
+      }
+    };
+  };
+
+  // S3-FIFO: new entries land in a small FIFO (10% of the capacity) and are
+  // dropped quickly unless they are hit again, which promotes them to the
+  // main FIFO. keys evicted from the small queue are remembered in a ghost
+  // FIFO of hashes, and reinserting one of them goes straight to main.
+  // hits only bump a 2-bit counter, so reads never touch the queue links.
+  struct S3FIFO {
+    template <typename Node>
+    class State {
+    private:
+      static constexpr uint8_t kSmall = 0;
+      static constexpr uint8_t kMain = 1;
+      static constexpr uint8_t kMaxFreq = 3;
+
+      cache::Queue<Node> small;
+      cache::Queue<Node> main;
+      size_t small_capacity;
+      std::deque<size_t> ghost;
+      HashMap<size_t, uint32_t> in_ghost;
+
+      cache::Queue<Node>& queue_of(Node* node) {
+        return node->queue == kMain ? main : small;
+      }
+
+      bool ghost_contains(size_t hash) {
+        return in_ghost.contains_key(hash);
+      }
+
+      // the ghost remembers about as many keys as the main queue holds
+      void ghost_push(size_t hash) {
+        ghost.push_back(hash);
+        auto count = in_ghost.get_mut(hash);
+        if (count.has_value()) {
+          (*count.value())++;
+        }
+        else {
+          in_ghost.insert(hash, 1);
+        }
+        size_t limit = main.len() < 16 ? 16 : main.len();
+        while (ghost.size() > limit) {
+          size_t oldest = ghost.front();
+          ghost.pop_front();
+          uint32_t* oldest_count = in_ghost.get_mut(oldest).value();
+          if (--(*oldest_count) == 0) {
+            in_ghost.remove(oldest);
+          }
+        }
+      }
+
+    public:
+      explicit State(size_t capacity) : small_capacity(capacity / 10 == 0 ? 1 : capacity / 10) {}
+
+      void on_insert(Node* node) {
+        node->freq = 0;
+        if (ghost_contains(node->hash)) {
+          node->queue = kMain;
+          main.push_front(node);
+        }
+        else {
+          node->queue = kSmall;
+          small.push_front(node);
+        }
+      }
+      void on_hit(Node* node) {
+        if (node->freq < kMaxFreq) {
+          node->freq++;
+        }
+      }
+      void on_update(Node* node, size_t old_weight, size_t new_weight) {
+        queue_of(node).reweigh(old_weight, new_weight);
+      }
+      void on_erase(Node* node) {
+        queue_of(node).remove(node);
+      }
+      Node* evict() {
+        while (true) {
+          if (!small.is_empty() && (small.weight() >= small_capacity || main.is_empty())) {
+            Node* oldest = small.back();
+            small.remove(oldest);
+            if (oldest->freq > 0) {
+              oldest->freq = 0;
+              oldest->queue = kMain;
+              main.push_front(oldest);
+              continue;
+            }
+            ghost_push(oldest->hash);
+            return oldest;
+          }
+          Node* oldest = main.back();
+          main.remove(oldest);
+          if (oldest->freq > 0) {
+            oldest->freq--;
+            main.push_front(oldest);
+            continue;
+          }
+          return oldest;
+        }
+      }
+    };
+  };
+
+  // fixed-capacity key/value cache. the capacity is expressed in the unit of
+  // the weigher: entries with cache::EntryCount (default) or bytes with
+  // cache::ByteSize. get and put are O(1) on top of the HashMap index; the
+  // recency/frequency bookkeeping lives in intrusive links inside each entry.
+  //
+  // not thread safe, see ShardedCache.
+  template <typename K, typename V, typename Policy = LRU, typename Weigher = cache::EntryCount>
+  class Cache {
+  private:
+    struct Node {
+      K key;
+      V value;
+      size_t hash;
+      size_t weight;
+      Node* prev = nullptr;
+      Node* next = nullptr;
+      uint8_t freq = 0;
+      uint8_t queue = 0;
+      Node(const K& key, const V& value, size_t hash, size_t weight)
+        : key(key), value(value), hash(hash), weight(weight) {}
+    };
+    using State = typename Policy::template State<Node>;
+
+    HashMap<K, Node*> index;
+    State policy;
+    Weigher weigher;
+    size_t capacity_;
+    size_t weight_ = 0;
+    size_t len_ = 0;
+    CacheStats stats_;
+
+  public:
+    explicit Cache(size_t capacity, Weigher weigher = Weigher())
+      : policy(capacity), weigher(weigher), capacity_(capacity) {}
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    ~Cache() {
+      drain();
+    }
+
+    // the hash the cache keys its index and entries by. the overloads
+    // taking `hash` expect it, so a caller that already hashed the key,
+    // to pick a shard, does not hash it again.
+    static uint64_t hash_of(const K& key) {
+      return HashMap<K, Node*>::hash_of(key);
+    }
+
+    // returns a copy of the cached value and records the access
+    std::optional<V> get(const K& key) {
+      return get(key, hash_of(key));
+    }
+
+    std::optional<V> get(const K& key, uint64_t hash) {
+      Node** slot = index.find(key, hash);
+      if (slot == nullptr) {
+        stats_.misses++;
+        return std::nullopt;
+      }
+      Node* node = *slot;
+      stats_.hits++;
+      policy.on_hit(node);
+      return node->value;
+    }
+
+    // does not count as an access
+    bool contains(const K& key) {
+      return index.contains_key(key);
+    }
+
+    bool contains(const K& key, uint64_t hash) {
+      return index.find(key, hash) != nullptr;
+    }
+
+    // inserts or replaces the value for `key`, evicting until the cache fits.
+    // returns false when the entry alone is heavier than the whole cache.
+    bool put(const K& key, const V& value) {
+      return put(key, hash_of(key), value);
+    }
+
+    bool put(const K& key, uint64_t hash, const V& value) {
+      size_t weight = weigher(key, value);
+      if (weight > capacity_) {
+        return false;
+      }
+      // one probe of the index finds the entry or the place for it
+      auto [slot, inserted] = index.try_emplace_hashed(key, hash, nullptr);
+      if (!inserted) {
+        Node* node = *slot;
+        policy.on_update(node, node->weight, weight);
+        weight_ = weight_ - node->weight + weight;
+        node->weight = weight;
+        node->value = value;
+        policy.on_hit(node);
+      }
+      else {
+        Node* node;
+        try {
+          node = new Node(key, value, hash, weight);
+        }
+        catch (...) {
+          index.remove(key, hash);
+          throw;
+        }
+        *slot = node;
+        // make room before the node joins the policy, so it cannot be
+        // picked as the victim of its own insertion
+        evict_until(capacity_ - weight);
+        policy.on_insert(node);
+        weight_ += weight;
+        len_++;
+        stats_.insertions++;
+      }
+      evict_until(capacity_);
+      return true;
+    }
+
+    std::optional<V> remove(const K& key) {
+      return remove(key, hash_of(key));
+    }
+
+    std::optional<V> remove(const K& key, uint64_t hash) {
+      auto removed = index.remove(key, hash);
+      if (!removed.has_value()) {
+        return std::nullopt;
+      }
+      Node* node = removed.value();
+      policy.on_erase(node);
+      V value = node->value;
+      release(node);
+      return value;
+    }
+
+    void clear() {
+      drain();
+      policy = State(capacity_);
+    }
+
+    [[nodiscard]] size_t len() const {
+      return len_;
+    }
+    [[nodiscard]] bool is_empty() const {
+      return len_ == 0;
+    }
+    // current total weight of the entries
+    [[nodiscard]] size_t weight() const {
+      return weight_;
+    }
+    [[nodiscard]] size_t capacity() const {
+      return capacity_;
+    }
+    [[nodiscard]] CacheStats stats() const {
+      return stats_;
+    }
+    void reset_stats() {
+      stats_ = CacheStats();
+    }
+
+  private:
+    void evict_until(size_t limit) {
+      while (weight_ > limit) {
+        Node* victim = policy.evict();
+        index.remove(victim->key, victim->hash);
+        release(victim);
+        stats_.evictions++;
+      }
+    }
+
+    void release(Node* node) {
+      weight_ -= node->weight;
+      len_--;
+      delete node;
+    }
+
+    void drain() {
+      while (len_ > 0) {
+        Node* node = policy.evict();
+        index.remove(node->key, node->hash);
+        release(node);
+      }
+    }
+  };
+
+  // thread safe cache split into `Shards` independently locked caches.
+  // keys are routed by the top bits of their hash, and each shard gets
+  // capacity / Shards of the total capacity.
+  template <typename K, typename V, typename Policy = LRU, typename Weigher = cache::EntryCount, size_t Shards = 16>
+  class ShardedCache {
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "shard count must be a power of two");
+  private:
+    using ShardCache = Cache<K, V, Policy, Weigher>;
+
+    struct alignas(64) Shard {
+      std::mutex lock;
+      ShardCache cache;
+      Shard(size_t capacity, Weigher weigher) : cache(capacity, weigher) {}
+    };
+    std::array<std::unique_ptr<Shard>, Shards> shards;
+
+    Shard& shard_for(uint64_t hash) {
+      return *shards[shard_of<Shards>(hash)];
+    }
+
+  public:
+    explicit ShardedCache(size_t capacity, Weigher weigher = Weigher()) {
+      size_t per_shard = capacity / Shards == 0 ? 1 : capacity / Shards;
+      for (auto& shard : shards) {
+        shard = std::make_unique<Shard>(per_shard, weigher);
+      }
+    }
+
+    std::optional<V> get(const K& key) {
+      uint64_t hash = ShardCache::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.cache.get(key, hash);
+    }
+
+    bool put(const K& key, const V& value) {
+      uint64_t hash = ShardCache::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.cache.put(key, hash, value);
+    }
+
+    std::optional<V> remove(const K& key) {
+      uint64_t hash = ShardCache::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.cache.remove(key, hash);
+    }
+
+    bool contains(const K& key) {
+      uint64_t hash = ShardCache::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.cache.contains(key, hash);
+    }
+
+    size_t len() {
+      size_t total = 0;
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->cache.len();
+      }
+      return total;
+    }
+
+    CacheStats stats() {
+      CacheStats total;
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->cache.stats();
+      }
+      return total;
+    }
+  };
+}
+
+#endif // DSUN_CACHE_H
@@ -0,0 +1,148 @@
+#ifndef DSUN_CONCURRENT_HASH_MAP_H
+#define DSUN_CONCURRENT_HASH_MAP_H
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include "hash.h"
+
+namespace dsun {
+
+  // hash map safe for concurrent use, split into `Shards` independently
+  // locked HashMaps. a key's shard is picked from its hash, so threads
+  // working on different shards never touch the same lock. the key is
+  // hashed once: the shard's map is handed the same hash.
+  //
+  // each shard has a reader-writer lock: get / contains_key / for_each
+  // share it, writers take it exclusively. every compound operation
+  // (upsert, compute_if_absent) runs under one exclusive lock and is atomic
+  // with respect to that key.
+  //
+  // values are returned by copy, since a reference would outlive the lock.
+  template <typename K, typename V, size_t Shards = 64>
+  class ConcurrentHashMap {
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "shard count must be a power of two");
+  private:
+    // one per cache line, so locking a shard does not invalidate its neighbours
+    struct alignas(64) Shard {
+      mutable std::shared_mutex lock;
+      HashMap<K, V> map;
+    };
+    std::array<Shard, Shards> shards;
+
+    Shard& shard_for(uint64_t hash) {
+      return shards[shard_of<Shards>(hash)];
+    }
+    const Shard& shard_for(uint64_t hash) const {
+      return shards[shard_of<Shards>(hash)];
+    }
+
+  public:
+    ConcurrentHashMap() = default;
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    // inserts or replaces the value. returns true if the key was new.
+    bool insert(const K& key, const V& value) {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::unique_lock<std::shared_mutex> guard(shard.lock);
+      return shard.map.insert_or_assign(key, hash, value).second;
+    }
+
+    std::optional<V> get(const K& key) const {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      const Shard& shard = shard_for(hash);
+      std::shared_lock<std::shared_mutex> guard(shard.lock);
+      const V* value = shard.map.find(key, hash);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      return *value;
+    }
+
+    bool contains_key(const K& key) const {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      const Shard& shard = shard_for(hash);
+      std::shared_lock<std::shared_mutex> guard(shard.lock);
+      return shard.map.find(key, hash) != nullptr;
+    }
+
+    std::optional<V> remove(const K& key) {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::unique_lock<std::shared_mutex> guard(shard.lock);
+      return shard.map.remove(key, hash);
+    }
+
+    // atomically inserts `initial` if the key is absent, or else calls
+    // update(V&) on the stored value. returns true if it inserted.
+    template <typename F>
+    bool upsert(const K& key, V initial, F update) {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      Shard& shard = shard_for(hash);
+      std::unique_lock<std::shared_mutex> guard(shard.lock);
+      auto entry = shard.map.entry(key, hash);
+      bool inserted = !entry.is_occupied();
+      entry.and_modify(update).or_insert(std::move(initial));
+      return inserted;
+    }
+
+    // returns the value for `key`, inserting make() first if there is none.
+    // make runs under the shard lock, at most once per absent key, so it
+    // should be cheap and must not call back into the map.
+    template <typename F>
+    V compute_if_absent(const K& key, F make) {
+      uint64_t hash = HashMap<K, V>::hash_of(key);
+      Shard& shard = shard_for(hash);
+      {
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        if (const V* value = std::as_const(shard.map).find(key, hash)) {
+          return *value;
+        }
+      }
+      std::unique_lock<std::shared_mutex> guard(shard.lock);
+      return shard.map.entry(key, hash).or_insert_with(make);
+    }
+
+    // calls f(key, value) for every entry, holding one shard's read lock
+    // at a time. weakly consistent: writes to shards not yet visited are
+    // seen, writes to shards already visited are not.
+    template <typename F>
+    void for_each(F f) const {
+      for (const Shard& shard : shards) {
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        shard.map.for_each([&](const K& key, const V& value) {
+          f(key, value);
+          });
+      }
+    }
+
+    // sums the shards one at a time, so approximate while writers are running
+    [[nodiscard]] size_t len() const {
+      size_t total = 0;
+      for (const Shard& shard : shards) {
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        total += shard.map.len();
+      }
+      return total;
+    }
+
+    [[nodiscard]] bool is_empty() const {
+      return len() == 0;
+    }
+
+    void clear() {
+      for (Shard& shard : shards) {
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        shard.map.clear();
+      }
+    }
+  };
+}
+
+#endif // DSUN_CONCURRENT_HASH_MAP_H
@@ -0,0 +1,112 @@
+#ifndef DSUN_CONCURRENT_QUEUE_H
+#define DSUN_CONCURRENT_QUEUE_H
+
+#include <atomic>
+#include <new>
+#include <optional>
+#include <utility>
+#include "epoch.h"
+
+namespace dsun {
+
+  // unbounded lock-free multi-producer multi-consumer FIFO
+  // (Michael & Scott, 1996), the concurrent counterpart of
+  // LinkedList::push_back / pop_front.
+  //
+  // head always points to a dummy node; the front element lives in the
+  // node after it. dequeued dummies are reclaimed through dsun::epoch.
+  template <typename T>
+  class ConcurrentQueue {
+  private:
+    struct Node {
+      std::atomic<Node*> next{ nullptr };
+      alignas(T) unsigned char storage[sizeof(T)];
+
+      T& value() {
+        return *std::launder(reinterpret_cast<T*>(storage));
+      }
+    };
+
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) std::atomic<Node*> tail;
+
+  public:
+    ConcurrentQueue() {
+      Node* dummy = new Node();
+      head.store(dummy, std::memory_order_relaxed);
+      tail.store(dummy, std::memory_order_relaxed);
+    }
+
+    ConcurrentQueue(const ConcurrentQueue&) = delete;
+    ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+    // no other thread may be using the queue
+    ~ConcurrentQueue() {
+      Node* dummy = head.load(std::memory_order_relaxed);
+      Node* node = dummy->next.load(std::memory_order_relaxed);
+      delete dummy;
+      while (node != nullptr) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        node->value().~T();
+        delete node;
+        node = next;
+      }
+    }
+
+    void push_back(T value) {
+      Node* node = new Node();
+      new (node->storage) T(std::move(value));
+      auto guard = epoch::pin();
+      while (true) {
+        Node* last = tail.load(std::memory_order_acquire);
+        Node* next = last->next.load(std::memory_order_acquire);
+        if (last != tail.load(std::memory_order_acquire)) {
+          continue;
+        }
+        if (next != nullptr) {
+          // tail is lagging behind, help the other producer
+          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+          continue;
+        }
+        if (last->next.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed)) {
+          tail.compare_exchange_strong(last, node, std::memory_order_release, std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+
+    std::optional<T> pop_front() {
+      auto guard = epoch::pin();
+      while (true) {
+        Node* first = head.load(std::memory_order_acquire);
+        Node* last = tail.load(std::memory_order_acquire);
+        Node* next = first->next.load(std::memory_order_acquire);
+        if (first != head.load(std::memory_order_acquire)) {
+          continue;
+        }
+        if (next == nullptr) {
+          return std::nullopt;
+        }
+        if (first == last) {
+          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+          continue;
+        }
+        if (head.compare_exchange_weak(first, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+          // next is the new dummy: its value now belongs to this thread only
+          std::optional<T> value(std::move(next->value()));
+          next->value().~T();
+          epoch::retire(first);
+          return value;
+        }
+      }
+    }
+
+    // a snapshot, may be stale by the time it returns
+    bool is_empty() const {
+      auto guard = epoch::pin();
+      return head.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) == nullptr;
+    }
+  };
+}
+
+#endif // DSUN_CONCURRENT_QUEUE_H
@@ -0,0 +1,865 @@
+#ifndef DSUN_CUCKOO_HASH_MAP_H
+#define DSUN_CUCKOO_HASH_MAP_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "epoch.h"
+#include "hash.h"
+
+namespace dsun {
+
+  // the parts shared by CuckooHashMap and ConcurrentCuckooHashMap.
+  //
+  // a key may live in one of two buckets of kSlots slots each: its home
+  // bucket, from the low bits of its hash, and an alternate bucket, the
+  // home index xor a function of the key's 8-bit tag (partial-key cuckoo
+  // hashing). either bucket is found from the other and the tag alone, so
+  // displacing a key never needs its full hash. a lookup reads the two
+  // buckets, plus the stash when it is not empty, and nothing else.
+  //
+  // an insert into two full buckets searches breadth first for a chain of
+  // at most kMaxDepth displacements that ends at a free slot, and moves
+  // the keys along it, last one first. if there is none the key goes to a
+  // small stash. when the stash is full the table doubles, unless it is
+  // less than half full: then the keys' hashes collide too much for more
+  // buckets to help, and the stash doubles instead.
+  namespace cuckoo {
+    static constexpr size_t kSlots = 4;
+    static constexpr size_t kStashSize = 8;
+    static constexpr size_t kMaxDepth = 5;
+    // buckets one path search may visit
+    static constexpr size_t kMaxSearch = 256;
+    // a path goes stale if one of its slots is moved by the path itself
+    static constexpr int kPathAttempts = 3;
+    // the table grows before it is more than 95% full
+    static constexpr size_t kMaxLoadPercent = 95;
+
+    // never 0, which marks a free slot
+    inline uint8_t tag_of(uint64_t hash) {
+      uint8_t tag = static_cast<uint8_t>(hash >> 56);
+      return tag == 0 ? 1 : tag;
+    }
+
+    inline size_t home_bucket(uint64_t hash, size_t mask) {
+      return static_cast<size_t>(hash) & mask;
+    }
+
+    // an involution: the alternate of the alternate is the bucket itself.
+    // the offset is never 0, which would leave the key a single bucket;
+    // there are always at least two.
+    inline size_t alt_bucket(size_t bucket, uint8_t tag, size_t mask) {
+      size_t offset = static_cast<size_t>((tag + 1ull) * 0xc6a4a7935bd1e995ull) & mask;
+      return bucket ^ (offset | (offset == 0));
+    }
+
+    // the home bucket takes the low bits of the hash and the tag the top
+    // byte, so a hasher that does not avalanche (the identity on integers)
+    // is mixed once more, as the swiss tables do
+    template <typename Hash, typename K>
+    uint64_t hash_of(const K& key) {
+      uint64_t hash = static_cast<uint64_t>(Hash{}(key));
+      if constexpr (requires { typename Hash::is_avalanching; }) {
+        return hash;
+      }
+      else {
+        return mix(hash);
+      }
+    }
+
+    inline size_t buckets_for(size_t capacity) {
+      size_t slots = capacity * 100 / kMaxLoadPercent + 1;
+      return std::bit_ceil(std::max<size_t>(2, (slots + kSlots - 1) / kSlots));
+    }
+
+    // aligned to a cache line when it fits in one, so a lookup touches at
+    // most two lines; a larger bucket keeps its natural alignment rather
+    // than be padded out
+    template <typename Body>
+    struct alignas(sizeof(Body) <= 64 ? 64 : alignof(Body)) Aligned : Body {};
+
+    struct Step {
+      size_t bucket;
+      size_t slot;
+    };
+
+    // steps[0] is in one of the new key's buckets and steps[len - 1] is a
+    // free slot. the key in steps[i] has steps[i + 1].bucket as its other
+    // bucket.
+    struct Path {
+      Step steps[kMaxDepth + 1];
+      size_t len = 0;
+    };
+
+    // breadth first from buckets b1 and b2, so the path found is one of the
+    // shortest. tag_at(bucket, slot) reads a tag, 0 for a free slot.
+    template <typename TagAt>
+    std::optional<Path> find_path(size_t b1, size_t b2, size_t mask, TagAt tag_at) {
+      struct Node {
+        size_t bucket;
+        int32_t parent;
+        uint8_t slot;
+        uint8_t depth;
+      };
+      Node nodes[kMaxSearch];
+      size_t count = 0;
+      nodes[count++] = { b1, -1, 0, 0 };
+      nodes[count++] = { b2, -1, 0, 0 };
+      for (size_t head = 0; head < count; head++) {
+        Node node = nodes[head];
+        for (size_t slot = 0; slot < kSlots; slot++) {
+          if (tag_at(node.bucket, slot) == 0) {
+            Path path;
+            path.len = node.depth + 1;
+            path.steps[node.depth] = { node.bucket, slot };
+            for (size_t i = node.depth, at = head; i > 0; i--) {
+              path.steps[i - 1] = { nodes[nodes[at].parent].bucket, nodes[at].slot };
+              at = nodes[at].parent;
+            }
+            return path;
+          }
+        }
+        if (node.depth == kMaxDepth) {
+          continue;
+        }
+        for (size_t slot = 0; slot < kSlots && count < kMaxSearch; slot++) {
+          size_t next = alt_bucket(node.bucket, tag_at(node.bucket, slot), mask);
+          nodes[count++] = { next, static_cast<int32_t>(head), static_cast<uint8_t>(slot), static_cast<uint8_t>(node.depth + 1) };
+        }
+      }
+      return std::nullopt;
+    }
+
+    // whether the key at `from` may move to the free slot `to`. fails when
+    // an earlier move of the same path already changed `from`.
+    template <typename TagAt>
+    bool can_move(const Step& from, const Step& to, size_t mask, TagAt tag_at) {
+      uint8_t tag = tag_at(from.bucket, from.slot);
+      return tag != 0 && tag_at(to.bucket, to.slot) == 0 && alt_bucket(from.bucket, tag, mask) == to.bucket;
+    }
+
+    // a T copied in and out as relaxed atomic words, so a reader can copy it
+    // while a writer changes it. the copy may be torn; the reader finds out
+    // from the version counters and throws it away.
+    template <typename T>
+      requires std::is_trivially_copyable_v<T>
+    class RacyCell {
+    private:
+      using Word = std::conditional_t<sizeof(T) % 8 == 0, uint64_t,
+        std::conditional_t<sizeof(T) % 4 == 0, uint32_t, unsigned char>>;
+      static constexpr size_t kWords = sizeof(T) / sizeof(Word);
+      std::atomic<Word> words[kWords] = {};
+    public:
+      T load() const {
+        std::array<Word, kWords> copy;
+        for (size_t i = 0; i < kWords; i++) {
+          copy[i] = words[i].load(std::memory_order_relaxed);
+        }
+        return std::bit_cast<T>(copy);
+      }
+      void store(const T& value) {
+        auto copy = std::bit_cast<std::array<Word, kWords>>(value);
+        for (size_t i = 0; i < kWords; i++) {
+          words[i].store(copy[i], std::memory_order_relaxed);
+        }
+      }
+    };
+  }
+
+  // hash map with worst-case constant lookups: a key is in one of two
+  // 4-slot buckets or in the small stash, see dsun::cuckoo. for a read path
+  // that needs a tight p99.9; HashMap and FlatHashMap have cheaper inserts.
+  //
+  // keys are hashed by `Hash`, dsun::Hash<K> by default. the map holds up
+  // to 95% of its slots, and a bucket fills one cache line when its tags,
+  // 4 keys and 4 values take at most 64 bytes (uint64_t keys with uint32_t
+  // values, say). pointers from find stay valid until the next insert or
+  // remove, either of which may move other keys.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>>
+  class CuckooHashMap {
+  private:
+    static constexpr size_t kSlots = cuckoo::kSlots;
+
+    // slots are raw storage; an element exists where the tag is not 0
+    struct BucketBody {
+      uint8_t tags[kSlots];
+      alignas(K) unsigned char keys[kSlots * sizeof(K)];
+      alignas(V) unsigned char values[kSlots * sizeof(V)];
+    };
+    struct Bucket : cuckoo::Aligned<BucketBody> {
+      K& key(size_t slot) {
+        return *std::launder(reinterpret_cast<K*>(this->keys + slot * sizeof(K)));
+      }
+      V& value(size_t slot) {
+        return *std::launder(reinterpret_cast<V*>(this->values + slot * sizeof(V)));
+      }
+    };
+
+    struct StashEntry {
+      uint64_t hash;
+      K key;
+      V value;
+    };
+
+    // a map with no buckets of its own, default built or moved from, reads
+    // these two shared empty ones and allocates on its first insert
+    static inline Bucket kNoBuckets[2] = {};
+    static constexpr size_t kDefaultCapacity = 16;
+
+    Bucket* buckets_ = kNoBuckets;
+    size_t mask_ = 1;
+    size_t len_ = 0;
+    std::vector<StashEntry> stash_;
+    size_t stash_capacity_ = cuckoo::kStashSize;
+
+    static uint64_t hash_key(const K& key) {
+      return cuckoo::hash_of<Hash>(key);
+    }
+
+    void allocate(size_t count) {
+      buckets_ = static_cast<Bucket*>(::operator new(count * sizeof(Bucket), std::align_val_t(alignof(Bucket))));
+      for (size_t b = 0; b < count; b++) {
+        std::fill(buckets_[b].tags, buckets_[b].tags + kSlots, uint8_t(0));
+      }
+      mask_ = count - 1;
+    }
+
+    void release() {
+      if (buckets_ == kNoBuckets) {
+        return;
+      }
+      for (size_t b = 0; b <= mask_; b++) {
+        for (size_t s = 0; s < kSlots; s++) {
+          if (buckets_[b].tags[s] != 0) {
+            std::destroy_at(&buckets_[b].key(s));
+            std::destroy_at(&buckets_[b].value(s));
+          }
+        }
+      }
+      ::operator delete(buckets_, std::align_val_t(alignof(Bucket)));
+      buckets_ = kNoBuckets;
+      mask_ = 1;
+    }
+
+    auto tag_reader() const {
+      return [this](size_t bucket, size_t slot) {
+        return buckets_[bucket].tags[slot];
+      };
+    }
+
+    // the value for `key`, or nullptr
+    V* locate(const K& key, uint64_t hash) const {
+      uint8_t tag = cuckoo::tag_of(hash);
+      size_t home = cuckoo::home_bucket(hash, mask_);
+      for (size_t b : { home, cuckoo::alt_bucket(home, tag, mask_) }) {
+        Bucket& bucket = buckets_[b];
+        for (size_t s = 0; s < kSlots; s++) {
+          if (bucket.tags[s] == tag && bucket.key(s) == key) {
+            return &bucket.value(s);
+          }
+        }
+      }
+      for (const StashEntry& entry : stash_) {
+        if (entry.hash == hash && entry.key == key) {
+          return const_cast<V*>(&entry.value);
+        }
+      }
+      return nullptr;
+    }
+
+    void move_slot(const cuckoo::Step& from, const cuckoo::Step& to) {
+      Bucket& source = buckets_[from.bucket];
+      Bucket& target = buckets_[to.bucket];
+      std::construct_at(&target.key(to.slot), std::move(source.key(from.slot)));
+      std::construct_at(&target.value(to.slot), std::move(source.value(from.slot)));
+      std::destroy_at(&source.key(from.slot));
+      std::destroy_at(&source.value(from.slot));
+      target.tags[to.slot] = source.tags[from.slot];
+      source.tags[from.slot] = 0;
+    }
+
+    // frees a slot in one of the buckets of `hash` by displacement.
+    // returns the freed slot, or nullopt if no path was found.
+    std::optional<cuckoo::Step> make_room(uint64_t hash) {
+      size_t home = cuckoo::home_bucket(hash, mask_);
+      size_t alt = cuckoo::alt_bucket(home, cuckoo::tag_of(hash), mask_);
+      for (int attempt = 0; attempt < cuckoo::kPathAttempts; attempt++) {
+        auto path = cuckoo::find_path(home, alt, mask_, tag_reader());
+        if (!path.has_value()) {
+          return std::nullopt;
+        }
+        size_t i = path->len - 1;
+        while (i > 0 && cuckoo::can_move(path->steps[i - 1], path->steps[i], mask_, tag_reader())) {
+          move_slot(path->steps[i - 1], path->steps[i]);
+          i--;
+        }
+        if (i == 0) {
+          return path->steps[0];
+        }
+      }
+      return std::nullopt;
+    }
+
+    void construct_at_slot(const cuckoo::Step& at, uint64_t hash, K&& key, V&& value) {
+      Bucket& bucket = buckets_[at.bucket];
+      std::construct_at(&bucket.key(at.slot), std::move(key));
+      std::construct_at(&bucket.value(at.slot), std::move(value));
+      bucket.tags[at.slot] = cuckoo::tag_of(hash);
+    }
+
+    // stores a key known to be absent, growing as often as it takes
+    void place(uint64_t hash, K key, V value) {
+      while (true) {
+        if (auto room = make_room(hash)) {
+          construct_at_slot(*room, hash, std::move(key), std::move(value));
+          return;
+        }
+        if (stash_.size() < stash_capacity_) {
+          stash_.push_back({ hash, std::move(key), std::move(value) });
+          return;
+        }
+        if (len_ * 2 < capacity()) {
+          stash_capacity_ *= 2;
+        }
+        else {
+          rehash((mask_ + 1) * 2);
+        }
+      }
+    }
+
+    void rehash(size_t count) {
+      Bucket* old = buckets_;
+      size_t old_count = mask_ + 1;
+      std::vector<StashEntry> old_stash = std::move(stash_);
+      stash_ = {};
+      allocate(count);
+      for (size_t b = 0; b < old_count; b++) {
+        for (size_t s = 0; s < kSlots; s++) {
+          if (old[b].tags[s] != 0) {
+            // hashed first: the by-value key argument may be moved into
+            // before the hash argument is evaluated
+            K& key = old[b].key(s);
+            uint64_t hash = hash_key(key);
+            place(hash, std::move(key), std::move(old[b].value(s)));
+            std::destroy_at(&old[b].key(s));
+            std::destroy_at(&old[b].value(s));
+          }
+        }
+      }
+      for (StashEntry& entry : old_stash) {
+        place(entry.hash, std::move(entry.key), std::move(entry.value));
+      }
+      ::operator delete(old, std::align_val_t(alignof(Bucket)));
+    }
+
+    // after a remove, stashed keys may fit into the table again
+    void drain_stash() {
+      for (size_t i = stash_.size(); i-- > 0;) {
+        if (auto room = make_room(stash_[i].hash)) {
+          construct_at_slot(*room, stash_[i].hash, std::move(stash_[i].key), std::move(stash_[i].value));
+          stash_.erase(stash_.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+      }
+    }
+
+  public:
+    // room for `capacity` entries before the first growth
+    explicit CuckooHashMap(size_t capacity = kDefaultCapacity) {
+      allocate(cuckoo::buckets_for(capacity));
+    }
+
+    CuckooHashMap(const CuckooHashMap&) = delete;
+    CuckooHashMap& operator=(const CuckooHashMap&) = delete;
+
+    // the moved-from map is left empty, with no buckets until its next insert
+    CuckooHashMap(CuckooHashMap&& other) noexcept {
+      *this = std::move(other);
+    }
+
+    CuckooHashMap& operator=(CuckooHashMap&& other) noexcept {
+      std::swap(buckets_, other.buckets_);
+      std::swap(mask_, other.mask_);
+      std::swap(len_, other.len_);
+      std::swap(stash_, other.stash_);
+      std::swap(stash_capacity_, other.stash_capacity_);
+      return *this;
+    }
+
+    ~CuckooHashMap() {
+      release();
+    }
+
+    // inserts the pair, or replaces the value. returns true if the key was new.
+    bool insert(const K& key, V value) {
+      uint64_t hash = hash_key(key);
+      if (V* found = locate(key, hash)) {
+        *found = std::move(value);
+        return false;
+      }
+      if (buckets_ == kNoBuckets) {
+        allocate(cuckoo::buckets_for(kDefaultCapacity));
+      }
+      if ((len_ + 1) * 100 > capacity() * cuckoo::kMaxLoadPercent) {
+        rehash((mask_ + 1) * 2);
+      }
+      place(hash, key, std::move(value));
+      len_++;
+      return true;
+    }
+
+    std::optional<V> remove(const K& key) {
+      uint64_t hash = hash_key(key);
+      uint8_t tag = cuckoo::tag_of(hash);
+      size_t home = cuckoo::home_bucket(hash, mask_);
+      for (size_t b : { home, cuckoo::alt_bucket(home, tag, mask_) }) {
+        Bucket& bucket = buckets_[b];
+        for (size_t s = 0; s < kSlots; s++) {
+          if (bucket.tags[s] == tag && bucket.key(s) == key) {
+            std::optional<V> value(std::move(bucket.value(s)));
+            std::destroy_at(&bucket.key(s));
+            std::destroy_at(&bucket.value(s));
+            bucket.tags[s] = 0;
+            len_--;
+            drain_stash();
+            return value;
+          }
+        }
+      }
+      for (size_t i = 0; i < stash_.size(); i++) {
+        if (stash_[i].hash == hash && stash_[i].key == key) {
+          std::optional<V> value(std::move(stash_[i].value));
+          stash_.erase(stash_.begin() + static_cast<std::ptrdiff_t>(i));
+          len_--;
+          return value;
+        }
+      }
+      return std::nullopt;
+    }
+
+    // pointer to the value for `key`, or nullptr
+    V* find(const K& key) {
+      return locate(key, hash_key(key));
+    }
+
+    const V* find(const K& key) const {
+      return locate(key, hash_key(key));
+    }
+
+    std::optional<V> get(const K& key) const {
+      const V* value = find(key);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      return *value;
+    }
+
+    bool contains_key(const K& key) const {
+      return find(key) != nullptr;
+    }
+
+    [[nodiscard]] size_t len() const {
+      return len_;
+    }
+
+    // number of slots
+    [[nodiscard]] size_t capacity() const {
+      return buckets_ == kNoBuckets ? 0 : (mask_ + 1) * kSlots;
+    }
+
+    [[nodiscard]] double load_factor() const {
+      return capacity() == 0 ? 0 : static_cast<double>(len_) / static_cast<double>(capacity());
+    }
+
+    void clear() {
+      if (buckets_ != kNoBuckets) {
+        size_t count = mask_ + 1;
+        release();
+        allocate(count);
+      }
+      stash_.clear();
+      stash_capacity_ = cuckoo::kStashSize;
+      len_ = 0;
+    }
+
+    // calls f(key, value) for every entry
+    template <typename F>
+    void for_each(F f) const {
+      for (size_t b = 0; b <= mask_; b++) {
+        for (size_t s = 0; s < kSlots; s++) {
+          if (buckets_[b].tags[s] != 0) {
+            f(std::as_const(buckets_[b].key(s)), std::as_const(buckets_[b].value(s)));
+          }
+        }
+      }
+      for (const StashEntry& entry : stash_) {
+        f(entry.key, entry.value);
+      }
+    }
+  };
+
+  // CuckooHashMap for many readers and a few writers. readers take no lock
+  // and write no shared memory; writers are serialized by one mutex.
+  //
+  // every bucket, and the stash, carries a version counter that a writer
+  // makes odd while it changes the bucket and even again when done; moving
+  // a key bumps both buckets at once. a reader notes the versions of the
+  // key's two buckets and the stash, copies what it needs, and starts over
+  // if any version was odd or has changed since. keys and values are copied
+  // while they may be written, so both must be trivially copyable.
+  //
+  // growth builds a new table aside and publishes it with one pointer
+  // store; the old one goes to dsun::epoch, which frees it once no reader
+  // is still looking at it.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>>
+    requires std::is_trivially_copyable_v<K>&& std::is_trivially_copyable_v<V>
+  class ConcurrentCuckooHashMap {
+  private:
+    static constexpr size_t kSlots = cuckoo::kSlots;
+    using Version = std::atomic<uint32_t>;
+
+    struct BucketBody {
+      Version version;
+      std::atomic<uint8_t> tags[kSlots] = {};
+      cuckoo::RacyCell<K> keys[kSlots];
+      cuckoo::RacyCell<V> values[kSlots];
+    };
+    using Bucket = cuckoo::Aligned<BucketBody>;
+
+    struct StashEntry {
+      cuckoo::RacyCell<uint64_t> hash;
+      cuckoo::RacyCell<K> key;
+      cuckoo::RacyCell<V> value;
+    };
+
+    struct Table {
+      std::unique_ptr<Bucket[]> buckets;
+      size_t mask;
+      // read by every lookup and written only when the stash changes
+      Version stash_version;
+      std::atomic<size_t> stash_len = 0;
+      size_t stash_capacity;
+      std::unique_ptr<StashEntry[]> stash;
+
+      Table(size_t count, size_t stash_capacity)
+        : buckets(new Bucket[count]()), mask(count - 1), stash_capacity(stash_capacity), stash(new StashEntry[stash_capacity]()) {}
+
+      size_t capacity() const {
+        return (mask + 1) * kSlots;
+      }
+    };
+
+    // the versions of one write, each made odd on entry and even on exit
+    class WriteSection {
+    private:
+      Version* versions[3];
+      size_t count = 0;
+    public:
+      WriteSection(std::initializer_list<Version*> list) {
+        for (Version* version : list) {
+          if (std::find(versions, versions + count, version) == versions + count) {
+            versions[count++] = version;
+            version->store(version->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+          }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+      WriteSection(const WriteSection&) = delete;
+      WriteSection& operator=(const WriteSection&) = delete;
+      ~WriteSection() {
+        for (size_t i = 0; i < count; i++) {
+          versions[i]->store(versions[i]->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+      }
+    };
+
+    // where a key sits: a bucket slot, or a stash index when bucket is null
+    struct Location {
+      Bucket* bucket;
+      size_t index;
+    };
+
+    std::atomic<Table*> table_;
+    std::mutex writer_;
+    std::atomic<size_t> len_ = 0;
+
+    static uint64_t hash_key(const K& key) {
+      return cuckoo::hash_of<Hash>(key);
+    }
+
+    static auto tag_reader(const Table& table) {
+      return [&table](size_t bucket, size_t slot) {
+        return table.buckets[bucket].tags[slot].load(std::memory_order_relaxed);
+      };
+    }
+
+    // reader side: the value in `bucket` under `key`, possibly torn
+    static std::optional<V> read_bucket(const Bucket& bucket, const K& key, uint8_t tag) {
+      for (size_t s = 0; s < kSlots; s++) {
+        if (bucket.tags[s].load(std::memory_order_relaxed) == tag && bucket.keys[s].load() == key) {
+          return bucket.values[s].load();
+        }
+      }
+      return std::nullopt;
+    }
+
+    static std::optional<V> read_stash(const Table& table, const K& key, uint64_t hash) {
+      size_t len = std::min(table.stash_len.load(std::memory_order_relaxed), table.stash_capacity);
+      for (size_t i = 0; i < len; i++) {
+        const StashEntry& entry = table.stash[i];
+        if (entry.hash.load() == hash && entry.key.load() == key) {
+          return entry.value.load();
+        }
+      }
+      return std::nullopt;
+    }
+
+    // writer side from here on: the table cannot change under it
+
+    static std::optional<Location> locate(Table& table, const K& key, uint64_t hash) {
+      uint8_t tag = cuckoo::tag_of(hash);
+      size_t home = cuckoo::home_bucket(hash, table.mask);
+      for (size_t b : { home, cuckoo::alt_bucket(home, tag, table.mask) }) {
+        Bucket& bucket = table.buckets[b];
+        for (size_t s = 0; s < kSlots; s++) {
+          if (bucket.tags[s].load(std::memory_order_relaxed) == tag && bucket.keys[s].load() == key) {
+            return Location{ &bucket, s };
+          }
+        }
+      }
+      size_t stash_len = table.stash_len.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < stash_len; i++) {
+        if (table.stash[i].hash.load() == hash && table.stash[i].key.load() == key) {
+          return Location{ nullptr, i };
+        }
+      }
+      return std::nullopt;
+    }
+
+    static std::optional<cuckoo::Step> make_room(Table& table, uint64_t hash) {
+      size_t home = cuckoo::home_bucket(hash, table.mask);
+      size_t alt = cuckoo::alt_bucket(home, cuckoo::tag_of(hash), table.mask);
+      for (int attempt = 0; attempt < cuckoo::kPathAttempts; attempt++) {
+        auto path = cuckoo::find_path(home, alt, table.mask, tag_reader(table));
+        if (!path.has_value()) {
+          return std::nullopt;
+        }
+        size_t i = path->len - 1;
+        while (i > 0 && cuckoo::can_move(path->steps[i - 1], path->steps[i], table.mask, tag_reader(table))) {
+          Bucket& source = table.buckets[path->steps[i - 1].bucket];
+          Bucket& target = table.buckets[path->steps[i].bucket];
+          size_t from = path->steps[i - 1].slot;
+          size_t to = path->steps[i].slot;
+          WriteSection section{ &source.version, &target.version };
+          target.keys[to].store(source.keys[from].load());
+          target.values[to].store(source.values[from].load());
+          target.tags[to].store(source.tags[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+          source.tags[from].store(0, std::memory_order_relaxed);
+          i--;
+        }
+        if (i == 0) {
+          return path->steps[0];
+        }
+      }
+      return std::nullopt;
+    }
+
+    static void write_slot(Bucket& bucket, size_t slot, uint64_t hash, const K& key, const V& value) {
+      bucket.keys[slot].store(key);
+      bucket.values[slot].store(value);
+      bucket.tags[slot].store(cuckoo::tag_of(hash), std::memory_order_relaxed);
+    }
+
+    // stores a key known to be absent. false if it fits neither the table
+    // nor the stash.
+    static bool place(Table& table, uint64_t hash, const K& key, const V& value) {
+      if (auto room = make_room(table, hash)) {
+        Bucket& bucket = table.buckets[room->bucket];
+        WriteSection section{ &bucket.version };
+        write_slot(bucket, room->slot, hash, key, value);
+        return true;
+      }
+      size_t stash_len = table.stash_len.load(std::memory_order_relaxed);
+      if (stash_len == table.stash_capacity) {
+        return false;
+      }
+      WriteSection section{ &table.stash_version };
+      table.stash[stash_len].hash.store(hash);
+      table.stash[stash_len].key.store(key);
+      table.stash[stash_len].value.store(value);
+      table.stash_len.store(stash_len + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    // copies every entry into a bigger table, or one with a bigger stash,
+    // and publishes it
+    void grow() {
+      Table* old = table_.load(std::memory_order_relaxed);
+      size_t count = old->mask + 1;
+      size_t stash_capacity = old->stash_capacity;
+      if (len_.load(std::memory_order_relaxed) * 2 < old->capacity()) {
+        stash_capacity *= 2;
+      }
+      else {
+        count *= 2;
+      }
+      while (true) {
+        auto next = std::make_unique<Table>(count, stash_capacity);
+        bool placed = true;
+        for (size_t b = 0; b <= old->mask && placed; b++) {
+          for (size_t s = 0; s < kSlots && placed; s++) {
+            if (old->buckets[b].tags[s].load(std::memory_order_relaxed) != 0) {
+              K key = old->buckets[b].keys[s].load();
+              placed = place(*next, hash_key(key), key, old->buckets[b].values[s].load());
+            }
+          }
+        }
+        size_t stash_len = old->stash_len.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < stash_len && placed; i++) {
+          placed = place(*next, old->stash[i].hash.load(), old->stash[i].key.load(), old->stash[i].value.load());
+        }
+        if (placed) {
+          table_.store(next.release(), std::memory_order_release);
+          epoch::retire(old);
+          return;
+        }
+        count *= 2;
+      }
+    }
+
+    void remove_from_stash(Table& table, size_t index) {
+      size_t last = table.stash_len.load(std::memory_order_relaxed) - 1;
+      table.stash[index].hash.store(table.stash[last].hash.load());
+      table.stash[index].key.store(table.stash[last].key.load());
+      table.stash[index].value.store(table.stash[last].value.load());
+      table.stash_len.store(last, std::memory_order_relaxed);
+    }
+
+    // after a remove, stashed keys may fit into the table again
+    void drain_stash(Table& table) {
+      for (size_t i = table.stash_len.load(std::memory_order_relaxed); i-- > 0;) {
+        uint64_t hash = table.stash[i].hash.load();
+        if (auto room = make_room(table, hash)) {
+          Bucket& bucket = table.buckets[room->bucket];
+          // the key is never absent from both places at once
+          WriteSection section{ &bucket.version, &table.stash_version };
+          write_slot(bucket, room->slot, hash, table.stash[i].key.load(), table.stash[i].value.load());
+          remove_from_stash(table, i);
+        }
+      }
+    }
+
+  public:
+    explicit ConcurrentCuckooHashMap(size_t capacity = 16)
+      : table_(new Table(cuckoo::buckets_for(capacity), cuckoo::kStashSize)) {}
+
+    ConcurrentCuckooHashMap(const ConcurrentCuckooHashMap&) = delete;
+    ConcurrentCuckooHashMap& operator=(const ConcurrentCuckooHashMap&) = delete;
+
+    // no reader may be using the map
+    ~ConcurrentCuckooHashMap() {
+      delete table_.load(std::memory_order_relaxed);
+    }
+
+    std::optional<V> get(const K& key) const {
+      uint64_t hash = hash_key(key);
+      uint8_t tag = cuckoo::tag_of(hash);
+      auto guard = epoch::pin();
+      const Table& table = *table_.load(std::memory_order_acquire);
+      size_t home = cuckoo::home_bucket(hash, table.mask);
+      const Bucket& first = table.buckets[home];
+      const Bucket& second = table.buckets[cuckoo::alt_bucket(home, tag, table.mask)];
+      while (true) {
+        uint32_t v1 = first.version.load(std::memory_order_acquire);
+        uint32_t v2 = second.version.load(std::memory_order_acquire);
+        uint32_t vs = table.stash_version.load(std::memory_order_acquire);
+        if (((v1 | v2 | vs) & 1) != 0) {
+          continue;
+        }
+        std::optional<V> found = read_bucket(first, key, tag);
+        if (!found.has_value()) {
+          found = read_bucket(second, key, tag);
+        }
+        if (!found.has_value()) {
+          found = read_stash(table, key, hash);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (first.version.load(std::memory_order_relaxed) == v1 && second.version.load(std::memory_order_relaxed) == v2
+          && table.stash_version.load(std::memory_order_relaxed) == vs) {
+          return found;
+        }
+      }
+    }
+
+    bool contains_key(const K& key) const {
+      return get(key).has_value();
+    }
+
+    // inserts or replaces the value. returns true if the key was new.
+    bool insert(const K& key, const V& value) {
+      std::lock_guard<std::mutex> lock(writer_);
+      uint64_t hash = hash_key(key);
+      Table* table = table_.load(std::memory_order_relaxed);
+      if (auto at = locate(*table, key, hash)) {
+        if (at->bucket != nullptr) {
+          WriteSection section{ &at->bucket->version };
+          at->bucket->values[at->index].store(value);
+        }
+        else {
+          WriteSection section{ &table->stash_version };
+          table->stash[at->index].value.store(value);
+        }
+        return false;
+      }
+      size_t len = len_.load(std::memory_order_relaxed);
+      if ((len + 1) * 100 > table->capacity() * cuckoo::kMaxLoadPercent) {
+        grow();
+      }
+      while (!place(*table_.load(std::memory_order_relaxed), hash, key, value)) {
+        grow();
+      }
+      len_.store(len + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    std::optional<V> remove(const K& key) {
+      std::lock_guard<std::mutex> lock(writer_);
+      Table& table = *table_.load(std::memory_order_relaxed);
+      auto at = locate(table, key, hash_key(key));
+      if (!at.has_value()) {
+        return std::nullopt;
+      }
+      std::optional<V> value;
+      if (at->bucket != nullptr) {
+        value = at->bucket->values[at->index].load();
+        WriteSection section{ &at->bucket->version };
+        at->bucket->tags[at->index].store(0, std::memory_order_relaxed);
+      }
+      else {
+        value = table.stash[at->index].value.load();
+        WriteSection section{ &table.stash_version };
+        remove_from_stash(table, at->index);
+      }
+      len_.store(len_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+      drain_stash(table);
+      return value;
+    }
+
+    // may be stale by the time it returns while writers are active
+    [[nodiscard]] size_t len() const {
+      return len_.load(std::memory_order_relaxed);
+    }
+  };
+}
+
+#endif // DSUN_CUCKOO_HASH_MAP_H
@@ -2,12 +2,22 @@
 #define DSUN_H
 
 #include "linked_list.h"
+#include "unrolled_list.h"
 #include "vec.h"
 #include "hash.h"
+#include "index_map.h"
+#include "cache.h"
 #include "stack.h"
 #include "vec_deque.h"
 #include "bstree.h"
 #include "avltree.h"
+#include "skip_list.h"
+#include "epoch.h"
+#include "concurrent_queue.h"
+#include "concurrent_hash_map.h"
+#include "cuckoo_hash_map.h"
+#include "snapshot_map.h"
+#include "static_hash_map.h"
 #include "raw/binary_tree.h"
 
 #endif // DSUN_H
\ No newline at end of file
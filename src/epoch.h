@@ -0,0 +1,202 @@
+#ifndef DSUN_EPOCH_H
+#define DSUN_EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dsun {
+
+  // epoch based memory reclamation for lock-free structures.
+  //
+  // a thread pins itself (epoch::pin()) while it may hold pointers into a
+  // shared structure. a node unlinked from the structure is handed to
+  // epoch::retire() instead of being deleted. the global epoch can only
+  // advance once every pinned thread has observed the current one, so a
+  // node retired in epoch e is freed once the global epoch reaches e + 2:
+  // by then no thread can still be pinned from before the unlink.
+  //
+  // threads register themselves on their first pin and give their record
+  // back when they exit; whatever they had retired is adopted by the
+  // remaining threads.
+  namespace epoch {
+    namespace detail {
+      // retired pointers are collected once a thread has this many pending
+      static constexpr size_t kCollectThreshold = 64;
+
+      struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+      };
+
+      // one per registered thread, reused after the thread exits.
+      // state is (epoch << 1) | pinned, so a collector reads both at once.
+      struct alignas(64) ThreadRecord {
+        std::atomic<uint64_t> state{ 0 };
+        std::atomic<bool> in_use{ true };
+        uint32_t pin_depth = 0;
+        std::vector<Retired> retired;
+        ThreadRecord* next = nullptr;
+      };
+
+      struct Domain {
+        alignas(64) std::atomic<uint64_t> global_epoch{ 2 };
+        std::atomic<ThreadRecord*> records{ nullptr };
+        std::mutex orphans_lock;
+        std::vector<Retired> orphans;
+
+        ThreadRecord* acquire_record() {
+          for (ThreadRecord* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+            bool expected = false;
+            if (!record->in_use.load(std::memory_order_relaxed)
+              && record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+              return record;
+            }
+          }
+          ThreadRecord* record = new ThreadRecord();
+          ThreadRecord* head = records.load(std::memory_order_relaxed);
+          do {
+            record->next = head;
+          } while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+          return record;
+        }
+
+        void release_record(ThreadRecord* record) {
+          if (!record->retired.empty()) {
+            std::lock_guard<std::mutex> guard(orphans_lock);
+            orphans.insert(orphans.end(), record->retired.begin(), record->retired.end());
+            record->retired.clear();
+          }
+          record->state.store(0, std::memory_order_release);
+          record->in_use.store(false, std::memory_order_release);
+        }
+
+        // advances the global epoch if every pinned thread is in the current one
+        uint64_t try_advance() {
+          uint64_t global = global_epoch.load(std::memory_order_seq_cst);
+          for (ThreadRecord* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+            uint64_t state = record->state.load(std::memory_order_seq_cst);
+            if ((state & 1) && (state >> 1) != global) {
+              return global;
+            }
+          }
+          if (global_epoch.compare_exchange_strong(global, global + 1, std::memory_order_seq_cst)) {
+            return global + 1;
+          }
+          return global;
+        }
+
+        // frees everything in `list` retired at least two epochs before `global`
+        static void free_expired(std::vector<Retired>& list, uint64_t global) {
+          size_t kept = 0;
+          for (size_t i = 0; i < list.size(); i++) {
+            if (list[i].epoch + 2 <= global) {
+              list[i].deleter(list[i].ptr);
+            }
+            else {
+              list[kept++] = list[i];
+            }
+          }
+          list.resize(kept);
+        }
+
+        void collect(ThreadRecord* record) {
+          uint64_t global = try_advance();
+          free_expired(record->retired, global);
+          std::unique_lock<std::mutex> guard(orphans_lock, std::try_to_lock);
+          if (guard.owns_lock() && !orphans.empty()) {
+            free_expired(orphans, global);
+          }
+        }
+      };
+
+      inline Domain& domain() {
+        static Domain instance;
+        return instance;
+      }
+
+      // registers the calling thread on first use and unregisters it at exit
+      struct ThreadHandle {
+        ThreadRecord* record;
+        ThreadHandle() : record(domain().acquire_record()) {}
+        ~ThreadHandle() {
+          domain().release_record(record);
+        }
+      };
+
+      inline ThreadRecord& local() {
+        thread_local ThreadHandle handle;
+        return *handle.record;
+      }
+    }
+
+    // keeps the calling thread pinned while alive. guards nest: only the
+    // outermost one publishes and clears the pin.
+    class Guard {
+    private:
+      detail::ThreadRecord* record;
+    public:
+      Guard() : record(&detail::local()) {
+        if (record->pin_depth++ == 0) {
+          uint64_t global = detail::domain().global_epoch.load(std::memory_order_relaxed);
+          record->state.store((global << 1) | 1, std::memory_order_relaxed);
+          // the pin must be visible before any load from the shared structure
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+      }
+      Guard(Guard&& other) noexcept : record(std::exchange(other.record, nullptr)) {}
+      Guard(const Guard&) = delete;
+      Guard& operator=(const Guard&) = delete;
+      Guard& operator=(Guard&&) = delete;
+      ~Guard() {
+        if (record != nullptr && --record->pin_depth == 0) {
+          record->state.store(record->state.load(std::memory_order_relaxed) & ~uint64_t(1), std::memory_order_release);
+        }
+      }
+    };
+
+    [[nodiscard]] inline Guard pin() {
+      return Guard();
+    }
+
+    // eagerly registers the calling thread, otherwise done on the first pin
+    inline void register_thread() {
+      detail::local();
+    }
+
+    // defers deleter(ptr) until no pinned thread can still reach ptr.
+    // ptr must already be unlinked from the shared structure.
+    inline void retire(void* ptr, void (*deleter)(void*)) {
+      detail::ThreadRecord& record = detail::local();
+      uint64_t global = detail::domain().global_epoch.load(std::memory_order_seq_cst);
+      record.retired.push_back({ ptr, deleter, global });
+      if (record.retired.size() >= detail::kCollectThreshold) {
+        detail::domain().collect(&record);
+      }
+    }
+
+    template <typename T>
+    void retire(T* ptr) {
+      retire(static_cast<void*>(ptr), [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // tries to advance the epoch and frees what the calling thread can.
+    // with no other thread pinned, a few calls free everything retired so far.
+    inline void collect() {
+      for (int i = 0; i < 3; i++) {
+        detail::domain().collect(&detail::local());
+      }
+    }
+
+    // number of pointers the calling thread retired that are not freed yet
+    inline size_t pending() {
+      return detail::local().retired.size();
+    }
+  }
+}
+
+#endif // DSUN_EPOCH_H
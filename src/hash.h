@@ -1,8 +1,24 @@
 #ifndef DSUN_HASH_H
 #define DSUN_HASH_H
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <concepts>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hash_stats.h"
+#include "hasher.h"
+#include "table_file.h"
 #include "vec.h"
 #include <variant>
 
@@ -15,30 +31,118 @@ namespace dsun {
     } -> std::convertible_to<std::size_t>;
   };
 
+  // the default hasher of every dsun hash table. integers, enums and
+  // pointers go straight through mix(); anything else has its std::hash
+  // mixed, since std::hash is the identity for integers on common
+  // standard libraries and leaves the high bits empty.
   template <Hashable T>
   struct Hash {
+    using is_avalanching = void;
     std::size_t operator()(const T& value) const {
-      return std::hash<T>{}(value);
+      if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+        return static_cast<std::size_t>(mix(static_cast<uint64_t>(value)));
+      }
+      else if constexpr (std::is_pointer_v<T>) {
+        return static_cast<std::size_t>(mix(reinterpret_cast<uintptr_t>(value)));
+      }
+      else {
+        return static_cast<std::size_t>(mix(static_cast<uint64_t>(std::hash<T>{}(value))));
+      }
+    }
+  };
+
+  // transparent: std::string_view and C strings hash the same as the
+  // std::string holding the same characters, so lookups need no temporary key
+  template <>
+  struct Hash<std::string> {
+    using is_transparent = void;
+    using is_avalanching = void;
+    std::size_t operator()(std::string_view value) const {
+      return static_cast<std::size_t>(hash_bytes(value.data(), value.size()));
     }
   };
+
+  template <>
+  struct Hash<std::string_view> : Hash<std::string> {};
+
+  // Q can be looked up in a map keyed by K without building a K
+  template <typename K, typename Q>
+  concept TransparentLookup = requires(const K & key, const Q & query) {
+    typename Hash<K>::is_transparent;
+    {
+      Hash<K>{}(query)
+    } -> std::convertible_to<std::size_t>;
+    {
+      key == query
+    } -> std::convertible_to<bool>;
+  };
+
+  // anything transparent, or convertible to K (converted once per call)
+  template <typename K, typename Q>
+  concept LookupKey = std::same_as<K, Q> || TransparentLookup<K, Q> || std::convertible_to<const Q&, K>;
+
+  // which of `Shards` partitions a hash belongs to, for containers that
+  // split their keys over several HashMaps. it multiplies by a different
+  // constant than the bucket index does, so the keys that land in one shard
+  // still spread over all the buckets of that shard's map.
+  template <size_t Shards>
+  size_t shard_of(uint64_t hash) {
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "shard count must be a power of two");
+    if constexpr (Shards == 1) {
+      return 0;
+    }
+    else {
+      return static_cast<size_t>(((hash ^ (hash >> 32)) * 0xD6E8FEB86659FD93ull) >> (64 - std::countr_zero(Shards)));
+    }
+  }
+  // hints the cache to start loading `address`. never faults, so it is
+  // fine on a null or dangling pointer.
+  inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+  }
+
+// a type without padding bytes whose equal values are byte-for-byte
+// equal is hashed as one byte range and the listed attributes are
+// ignored; anything else folds the attributes with dsun::hash_combine.
 #define DERIVE_HASH(class_name) \
 namespace std { \
 template<> \
 struct hash<class_name> { \
     size_t operator()(const class_name& obj) const { \
-        size_t result = 0;
+        if constexpr (std::has_unique_object_representations_v<class_name>) { \
+            return static_cast<size_t>(dsun::hash_bytes(&obj, sizeof(obj))); \
+        } \
+        uint64_t result = 0;
 
 #define HASH_CLASS_ATTRIBUTE(attribute) \
-        result ^= std::hash<decltype(obj.attribute)>()(obj.attribute) + 0x9e3779b9 + (result<<6) + (result>>2);
+        result = dsun::hash_combine(result, dsun::Hash<std::remove_cvref_t<decltype(obj.attribute)>>{}(obj.attribute));
 
 #define END_DERIVE_HASH() \
-        return result; \
+        return static_cast<size_t>(result); \
     } \
 }; \
 }
 
 }
 namespace dsun {
+  // separate chaining hash map.
+  //
+  // the bucket count is a power of two and a hash picks its bucket with
+  // fibonacci hashing (multiply by 2^64 / phi, keep the top bits), so no
+  // division happens on lookup and identity hashes still spread out.
+  //
+  // when len() exceeds max_load_factor() * capacity() the bucket array
+  // doubles. rehashing is incremental: every insert and remove moves a
+  // few buckets of the old array over, so growth never stalls a single call.
+  // while a resize is in flight, a key lives in the old bucket array if its
+  // old bucket has not been migrated yet and in the new one otherwise, so a
+  // lookup still walks exactly one chain.
   template<typename Hashable, typename V>
   class HashMap {
   private:
@@ -48,154 +152,666 @@ namespace dsun {
       K key;
       T value;
       Node* next;
-      Node(K key, T value, Node* next) : key(key), value(value), next(next) {}
+      uint64_t hash;
+      template <typename KeyArg, typename... Args>
+      Node(uint64_t hash, KeyArg&& key, Args&&... args)
+        : key(std::forward<KeyArg>(key)), value(std::forward<Args>(args)...), next(nullptr), hash(hash) {}
+    };
+
+    // nodes are carved out of slabs owned by the map instead of one heap
+    // allocation each, so neighbouring chain entries usually share a cache
+    // line or page. released nodes go on a free list and are reused before
+    // a new slab is taken; the slabs themselves are only freed with the map.
+    class NodePool {
+    private:
+      union Slot {
+        Slot* next_free;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+      };
+      static constexpr size_t kFirstSlab = 16;
+      static constexpr size_t kMaxSlab = 4096;
+
+      std::vector<std::unique_ptr<Slot[]>> slabs;
+      Slot* free_list = nullptr;
+      Slot* cursor = nullptr;
+      Slot* slab_end = nullptr;
+      size_t next_slab = kFirstSlab;
+      size_t slab_slots = 0;
+
+      Slot* take() {
+        if (free_list != nullptr) {
+          return std::exchange(free_list, free_list->next_free);
+        }
+        if (cursor == slab_end) {
+          slabs.push_back(std::make_unique_for_overwrite<Slot[]>(next_slab));
+          cursor = slabs.back().get();
+          slab_end = cursor + next_slab;
+          slab_slots += next_slab;
+          next_slab = std::min(next_slab * 2, kMaxSlab);
+        }
+        return cursor++;
+      }
+    public:
+      NodePool() = default;
+      NodePool(const NodePool&) = delete;
+      NodePool& operator=(const NodePool&) = delete;
+
+      template <typename... Args>
+      Node* create(Args&&... args) {
+        Slot* slot = take();
+        try {
+          return new (slot->storage) Node(std::forward<Args>(args)...);
+        }
+        catch (...) {
+          slot->next_free = std::exchange(free_list, slot);
+          throw;
+        }
+      }
+
+      void release(Node* node) {
+        node->~Node();
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next_free = std::exchange(free_list, slot);
+      }
+
+      // drops every slab at once. live nodes must have been destroyed.
+      void reset() {
+        slabs.clear();
+        free_list = nullptr;
+        cursor = nullptr;
+        slab_end = nullptr;
+        next_slab = kFirstSlab;
+        slab_slots = 0;
+      }
+
+      size_t bytes() const {
+        return slab_slots * sizeof(Slot);
+      }
+
+      void swap(NodePool& other) noexcept {
+        std::swap(slabs, other.slabs);
+        std::swap(free_list, other.free_list);
+        std::swap(cursor, other.cursor);
+        std::swap(slab_end, other.slab_end);
+        std::swap(next_slab, other.next_slab);
+        std::swap(slab_slots, other.slab_slots);
+      }
     };
-    dsun::Vec<Node*> table;
+
+    // a default-constructed Buckets has no buckets and allocates nothing.
+    // its slots are two shared null heads, which every index lands on
+    // while shift is 63, so a lookup in it misses without a branch. it is
+    // never written: find_link allocates first.
+    struct Buckets {
+      static inline Node* kNoBuckets[2] = {};
+
+      std::unique_ptr<Node*[]> owned;
+      Node** slots = kNoBuckets;
+      size_t count = 0;
+      uint32_t shift = 63;
+
+      Buckets() = default;
+      explicit Buckets(size_t count)
+        : owned(std::make_unique<Node*[]>(count)), slots(owned.get()), count(count), shift(64 - std::countr_zero(count)) {}
+      Buckets(Buckets&& other) noexcept
+        : owned(std::move(other.owned)), slots(std::exchange(other.slots, kNoBuckets)),
+        count(std::exchange(other.count, 0)), shift(std::exchange(other.shift, 63)) {}
+      Buckets& operator=(Buckets&& other) noexcept {
+        std::swap(owned, other.owned);
+        std::swap(slots, other.slots);
+        std::swap(count, other.count);
+        std::swap(shift, other.shift);
+        return *this;
+      }
+
+      size_t index(uint64_t hash) const {
+        return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ull) >> shift);
+      }
+      Node*& operator[](size_t index) const {
+        return slots[index];
+      }
+    };
+
+    static constexpr size_t kMinBuckets = 16;
+    // more than any machine can allocate, so the doubling in buckets_for
+    // stops before it overflows and the allocation fails instead
+    static constexpr size_t kMaxBuckets = size_t(1) << 60;
+    // old buckets migrated per insert/remove while a resize is in flight
+    static constexpr size_t kRehashStep = 8;
+
+    NodePool pool;
+    Buckets table;
+    Buckets old_table;
+    size_t migrated = 0;
     size_t len_ = 0;
-    std::size_t hash(const K& key) const {
-      return Hash<K>{}(key) % table.capacity();
+    float max_load_ = 1.0f;
+    // stay with the map object, they are not swapped or copied
+    [[no_unique_address]] hash_stats::LookupCounters<> counters;
+
+    template <typename Q>
+    static uint64_t hash(const Q& key) {
+      return static_cast<uint64_t>(Hash<K>{}(key));
     }
-  public:
-    HashMap() : table(dsun::Vec<Node*>::with_capacity(16)) {}
 
-    void insert(const K& key, const T& value) {
-      std::size_t index = hash(key);
-      Node* new_node = new Node(key, value, nullptr);
-      if (table.get(index).has_value() == false) {
-        table.as_slice()[index] = new_node;
-        table.set_len(table.len() + 1);
-        len_++;
-        return;
+    bool is_migrating() const {
+      return old_table.count != 0;
+    }
+
+    // the chain that holds (or would hold) a key with this hash
+    Node*& bucket(uint64_t hash) const {
+      if (is_migrating()) {
+        size_t old_index = old_table.index(hash);
+        if (old_index >= migrated) {
+          return old_table[old_index];
+        }
       }
-      Node* node = table.get(index).value();
-      while (node->next != nullptr) {
-        node = node->next;
+      return table[table.index(hash)];
+    }
+
+    template <typename Q>
+    Node* find_node(const Q& key) const {
+      const auto& lookup = lookup_key(key);
+      return find_hashed(lookup, hash(lookup));
+    }
+
+    // `lookup` is already a K or transparent to it, and `h` its hash
+    template <typename Q>
+    Node* find_hashed(const Q& lookup, uint64_t h) const {
+      uint64_t probes = 0;
+      for (Node* node = bucket(h); node != nullptr; node = node->next) {
+        probes++;
+        if (node->hash == h && node->key == lookup) {
+          counters.record(true, probes);
+          return node;
+        }
       }
-      node->next = new_node;
+      counters.record(false, probes);
+      return nullptr;
     }
 
-    std::optional<T> remove(const K& key) {
-      std::size_t index = hash(key);
-      if (table.get(index).has_value() == false) {
-        return std::nullopt;
+    // the key itself when it can be hashed and compared against K,
+    // otherwise a K converted from it
+    template <typename Q>
+    static decltype(auto) lookup_key(const Q& key) {
+      if constexpr (std::same_as<K, Q> || TransparentLookup<K, Q>) {
+        return (key);
       }
-      Node* node = table.get(index).value();
-      if (node->key == key) {
-        table.as_slice()[index] = node->next;
-        table.set_len(table.len() - 1);
-        T value = node->value;
-        delete node;
-        len_--;
-        return value;
-      }
-      while (node->next != nullptr) {
-        if (node->next->key == key) {
-          Node* next = node->next;
-          node->next = next->next;
-          T value = next->value;
-          delete next;
-          len_--;
-          return value;
-        }
-        node = node->next;
+      else {
+        return static_cast<K>(key);
       }
-      return std::nullopt;
     }
 
-    std::optional<T> get(const K& key) {
-      std::size_t index = hash(key);
-      if (table.get(index).has_value() == false) {
-        return std::nullopt;
+    // the link that points at the node for `key`, or the null link at the
+    // end of its chain where the key would be appended
+    template <typename Q>
+    Node** find_link(const Q& key, uint64_t h) {
+      if (table.count == 0) {
+        table = Buckets(kMinBuckets);
       }
-      Node* node = table.get(index).value();
-      while (node != nullptr) {
-        if (node->key == key) {
-          return node->value;
+      Node** link = &bucket(h);
+      uint64_t probes = 0;
+      for (; *link != nullptr; link = &(*link)->next) {
+        probes++;
+        if ((*link)->hash == h && (*link)->key == key) {
+          break;
         }
-        node = node->next;
       }
-      return std::nullopt;
+      counters.record(*link != nullptr, probes);
+      return link;
+    }
+
+    // try_emplace once the key's lookup form and hash are known
+    template <typename Q, typename L, typename... Args>
+    std::pair<T*, bool> emplace_hashed(Q&& key, const L& lookup, uint64_t h, Args&&... args) {
+      rehash_step(kRehashStep);
+      Node** link = find_link(lookup, h);
+      if (*link != nullptr) {
+        return { &(*link)->value, false };
+      }
+      *link = pool.create(h, std::forward<Q>(key), std::forward<Args>(args)...);
+      return { &after_insert(*link)->value, true };
+    }
+
+    // insert_or_assign once the key's lookup form and hash are known
+    template <typename Q, typename L, typename M>
+    std::pair<T*, bool> assign_hashed(Q&& key, const L& lookup, uint64_t h, M&& value) {
+      rehash_step(kRehashStep);
+      Node** link = find_link(lookup, h);
+      if (*link != nullptr) {
+        (*link)->value = std::forward<M>(value);
+        return { &(*link)->value, false };
+      }
+      *link = pool.create(h, std::forward<Q>(key), std::forward<M>(value));
+      return { &after_insert(*link)->value, true };
     }
 
-    std::optional<T*> get_mut(const K& key) {
-      std::size_t index = hash(key);
-      if (table.get(index).has_value() == false) {
+    template <typename L>
+    std::optional<T> remove_hashed(const L& lookup, uint64_t h) {
+      rehash_step(kRehashStep);
+      Node** link = find_link(lookup, h);
+      if (*link == nullptr) {
         return std::nullopt;
       }
-      Node* node = table.get(index).value();
+      Node* node = *link;
+      *link = node->next;
+      std::optional<T> value(std::move(node->value));
+      pool.release(node);
+      len_--;
+      return value;
+    }
+
+    // grows after an insertion pushed the map over its load factor.
+    // returns the inserted node, still valid after the grow.
+    Node* after_insert(Node* node) {
+      len_++;
+      if (static_cast<double>(len_) > static_cast<double>(table.count) * max_load_) {
+        start_grow();
+      }
+      return node;
+    }
+
+    // moves one old bucket over. with fibonacci indexing old bucket i splits
+    // into new buckets 2i and 2i + 1, so appending keeps the chain order.
+    void migrate_bucket(size_t index) {
+      Node* node = old_table[index];
+      old_table[index] = nullptr;
+      Node** tails[2] = { &table[2 * index], &table[2 * index + 1] };
       while (node != nullptr) {
-        if (node->key == key) {
-          return &node->value;
-        }
-        node = node->next;
+        Node* next = node->next;
+        Node**& tail = tails[table.index(node->hash) - 2 * index];
+        node->next = nullptr;
+        *tail = node;
+        tail = &node->next;
+        node = next;
       }
-      return std::nullopt;
     }
 
-    bool contains_key(const K& key) {
-      std::size_t index = hash(key);
-      if (table.get(index).has_value() == false) {
-        return false;
+    void rehash_step(size_t buckets) {
+      if (!is_migrating()) {
+        return;
       }
-      Node* node = table.get(index).value();
-      while (node != nullptr) {
-        if (node->key == key) {
-          return true;
+      for (size_t i = 0; i < buckets && migrated < old_table.count; i++) {
+        migrate_bucket(migrated++);
+      }
+      if (migrated == old_table.count) {
+        old_table = Buckets();
+        migrated = 0;
+      }
+    }
+
+    void finish_rehash() {
+      rehash_step(old_table.count);
+    }
+
+    void start_grow() {
+      finish_rehash();
+      old_table = std::move(table);
+      table = Buckets(old_table.count * 2);
+      migrated = 0;
+    }
+
+    static size_t buckets_for(size_t len, float max_load) {
+      double needed = static_cast<double>(len) / max_load + 1;
+      size_t count = kMinBuckets;
+      while (count < kMaxBuckets && static_cast<double>(count) < needed) {
+        count *= 2;
+      }
+      return count;
+    }
+
+    // runs the node destructors (if any) and hands all the slabs back
+    void destroy_nodes() {
+      if constexpr (!std::is_trivially_destructible_v<Node>) {
+        for_each_node([](Node* node) {
+          node->~Node();
+          });
+      }
+      pool.reset();
+    }
+
+    // rebuilds the table with `count` buckets in one go
+    // allocates before touching the table, so a failed allocation leaves it as it was
+    void rehash_to(size_t count) {
+      Buckets fresh(count);
+      finish_rehash();
+      Buckets old = std::move(table);
+      table = std::move(fresh);
+      for (size_t i = 0; i < old.count; i++) {
+        Node* node = old[i];
+        while (node != nullptr) {
+          Node* next = node->next;
+          Node*& head = table[table.index(node->hash)];
+          node->next = head;
+          head = node;
+          node = next;
         }
-        node = node->next;
       }
-      return false;
+    }
+
+  public:
+    HashMap() : table(kMinBuckets) {}
+
+    HashMap(const HashMap<K, T>& other) : table(buckets_for(other.len_, other.max_load_)), max_load_(other.max_load_) {
+      other.for_each_node([&](Node* node) {
+        insert(node->key, node->value);
+        });
+    }
+
+    // the moved-from map is left empty, with no buckets until its next insert
+    HashMap(HashMap<K, T>&& other) noexcept {
+      swap(other);
+    }
+
+    HashMap<K, T>& operator=(HashMap<K, T> other) noexcept {
+      swap(other);
+      return *this;
+    }
+
+    ~HashMap() {
+      destroy_nodes();
+    }
+
+    void swap(HashMap<K, T>& other) noexcept {
+      pool.swap(other.pool);
+      std::swap(table, other.table);
+      std::swap(old_table, other.old_table);
+      std::swap(migrated, other.migrated);
+      std::swap(len_, other.len_);
+      std::swap(max_load_, other.max_load_);
+    }
+
+    // removes every entry, keeping the current bucket array
+    void clear() {
+      destroy_nodes();
+      old_table = Buckets();
+      migrated = 0;
+      for (size_t i = 0; i < table.count; i++) {
+        table[i] = nullptr;
+      }
+      len_ = 0;
+    }
+
+    static HashMap<K, T> with_capacity(size_t capacity) {
+      HashMap<K, T> map;
+      map.reserve(capacity);
+      return map;
+    }
+
+    // inserts the pair, or replaces the value if the key is already present
+    void insert(const K& key, const T& value) {
+      insert_or_assign(key, value);
+    }
+
+    // constructs the value from `args` only if the key is absent.
+    // returns the value for the key and whether it was inserted.
+    template <typename Q, typename... Args>
+      requires LookupKey<K, std::remove_cvref_t<Q>>
+    std::pair<T*, bool> try_emplace(Q&& key, Args&&... args) {
+      const auto& lookup = lookup_key(key);
+      return emplace_hashed(std::forward<Q>(key), lookup, hash(lookup), std::forward<Args>(args)...);
+    }
+
+    // try_emplace for a key whose hash_of() is already known. named apart
+    // since the hash would otherwise read as the first constructor argument.
+    template <typename Q, typename... Args>
+      requires LookupKey<K, std::remove_cvref_t<Q>>
+    std::pair<T*, bool> try_emplace_hashed(Q&& key, uint64_t h, Args&&... args) {
+      const auto& lookup = lookup_key(key);
+      return emplace_hashed(std::forward<Q>(key), lookup, h, std::forward<Args>(args)...);
+    }
+
+    // inserts, or assigns over the existing value.
+    // returns the value for the key and whether it was inserted.
+    template <typename Q, typename M>
+      requires LookupKey<K, std::remove_cvref_t<Q>>
+    std::pair<T*, bool> insert_or_assign(Q&& key, M&& value) {
+      const auto& lookup = lookup_key(key);
+      return assign_hashed(std::forward<Q>(key), lookup, hash(lookup), std::forward<M>(value));
+    }
+
+    // as above, for a key whose hash_of() is already known
+    template <typename Q, typename M>
+      requires LookupKey<K, std::remove_cvref_t<Q>>
+    std::pair<T*, bool> insert_or_assign(Q&& key, uint64_t h, M&& value) {
+      const auto& lookup = lookup_key(key);
+      return assign_hashed(std::forward<Q>(key), lookup, h, std::forward<M>(value));
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<T> remove(const Q& key) {
+      const auto& lookup = lookup_key(key);
+      return remove_hashed(lookup, hash(lookup));
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<T> remove(const Q& key, uint64_t h) {
+      return remove_hashed(lookup_key(key), h);
+    }
+
+    // the hash the map stores for `key`. a caller that hashes the key
+    // anyway, to pick a shard say, hands it to the overloads taking `h`
+    // so the key is hashed once. h must be hash_of() of an equal key.
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    static uint64_t hash_of(const Q& key) {
+      return hash(lookup_key(key));
+    }
+
+    // pointer to the value for `key`, or nullptr. stays valid until the
+    // entry is removed, rehashing only relinks nodes.
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    T* find(const Q& key) {
+      Node* node = find_node(key);
+      return node == nullptr ? nullptr : &node->value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    const T* find(const Q& key) const {
+      Node* node = find_node(key);
+      return node == nullptr ? nullptr : &node->value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    T* find(const Q& key, uint64_t h) {
+      Node* node = find_hashed(lookup_key(key), h);
+      return node == nullptr ? nullptr : &node->value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    const T* find(const Q& key, uint64_t h) const {
+      Node* node = find_hashed(lookup_key(key), h);
+      return node == nullptr ? nullptr : &node->value;
+    }
+
+    // returns a copy of the value, see find() to avoid it
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<T> get(const Q& key) const {
+      Node* node = find_node(key);
+      if (node == nullptr) {
+        return std::nullopt;
+      }
+      return node->value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<T*> get_mut(const Q& key) {
+      Node* node = find_node(key);
+      if (node == nullptr) {
+        return std::nullopt;
+      }
+      return &node->value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    bool contains_key(const Q& key) const {
+      return find_node(key) != nullptr;
     }
 
     [[nodiscard]] size_t len() const {
       return len_;
     }
 
+    // number of buckets
     [[nodiscard]] size_t capacity() const {
-      return table.capacity();
+      return table.count;
+    }
+
+    [[nodiscard]] float load_factor() const {
+      return table.count == 0 ? 0 : static_cast<float>(len_) / static_cast<float>(table.count);
+    }
+
+    [[nodiscard]] float max_load_factor() const {
+      return max_load_;
+    }
+
+    // a lower factor means shorter chains and more buckets. the table does
+    // not shrink, but grows right away if it is now over the limit. throws
+    // std::invalid_argument unless the factor is positive and finite.
+    void set_max_load_factor(float max_load) {
+      if (!std::isfinite(max_load) || max_load <= 0) {
+        throw std::invalid_argument("Max load factor must be positive and finite");
+      }
+      size_t count = buckets_for(len_, max_load);
+      if (count > table.count) {
+        rehash_to(count);
+      }
+      max_load_ = max_load;
+    }
+
+    // makes room for `capacity` entries without further growth
+    void reserve(size_t capacity) {
+      size_t count = buckets_for(capacity, max_load_);
+      if (count > table.count) {
+        rehash_to(count);
+      }
     }
 
+    [[nodiscard]] bool is_rehashing() const {
+      return is_migrating();
+    }
+
+    // load, chain lengths and memory, from a walk over every bucket. while
+    // a resize is in flight the old buckets not yet moved count as well.
+    TableStats stats() const {
+      TableStats stats;
+      stats.len = len_;
+      stats.capacity = table.count;
+      stats.load_factor = load_factor();
+      for (uint32_t i = 0; i < bucket_span(); i++) {
+        if (i >= table.count && i - table.count < migrated) {
+          continue;
+        }
+        size_t length = 0;
+        for (Node* node = bucket_at(i); node != nullptr; node = node->next) {
+          length++;
+        }
+        hash_stats::add_to_histogram(stats.chain_lengths, length);
+      }
+      stats.bytes_allocated = (table.count + old_table.count) * sizeof(Node*) + pool.bytes();
+      counters.read(stats);
+      return stats;
+    }
+
+    // zeroes the lookup counters of stats()
+    void reset_stats() {
+      counters.reset();
+    }
+
+    // a located slot for one key, from a single hash and chain walk.
+    // it points into the map, so the map must not be modified through
+    // anything else while the entry is alive.
     class Entry {
       struct Occupied {
-        K key;
-        T value;
-        HashMap<K, T>* base;
-        Occupied(K key, T value, HashMap<K, T>* base) : key(key), value(value), base(base) {}
+        Node* node;
       };
       struct Vacant {
         K key;
-        HashMap<K, T>* base;
-        Vacant(K key, HashMap<K, T>* base) : key(key), base(base) {}
+        uint64_t hash;
+        // the null link at the end of the key's chain
+        Node** link;
       };
 
+      HashMap<K, T>* base;
       std::variant<Occupied, Vacant> entry;
+
+      template <typename... Args>
+      T& insert_vacant(Args&&... args) {
+        Vacant& vacant = std::get<Vacant>(entry);
+        Node* node = base->pool.create(vacant.hash, std::move(vacant.key), std::forward<Args>(args)...);
+        *vacant.link = node;
+        entry = Occupied{ node };
+        return base->after_insert(node)->value;
+      }
     public:
-      Entry(K key, T value, HashMap<K, T>* base) : entry(Occupied(key, value, base)) {}
-      Entry(K key, HashMap<K, T>* base) : entry(Vacant(key, base)) {}
+      Entry(HashMap<K, T>* base, Node* node) : base(base), entry(Occupied{ node }) {}
+      Entry(HashMap<K, T>* base, K key, uint64_t hash, Node** link) : base(base), entry(Vacant{ std::move(key), hash, link }) {}
+
+      [[nodiscard]] bool is_occupied() const {
+        return std::holds_alternative<Occupied>(entry);
+      }
 
-      T or_insert(T value) {
-        if (std::holds_alternative<Occupied>(entry)) {
-          return std::get<Occupied>(entry).base->get(std::get<Occupied>(entry).key).value();
+      const K& key() const {
+        if (is_occupied()) {
+          return std::get<Occupied>(entry).node->key;
         }
-        Vacant vacant = std::get<Vacant>(entry);
-        vacant.base->insert(vacant.key, value);
-        return value;
+        return std::get<Vacant>(entry).key;
       }
 
-      Entry& and_modify(std::function<void(T&)> f) {
-        if (std::holds_alternative<Occupied>(entry)) {
-          f(*std::get<Occupied>(entry).base->get_mut(std::get<Occupied>(entry).key).value());
+      // the value for the key, inserting `value` first if there is none
+      T& or_insert(T value) {
+        if (is_occupied()) {
+          return std::get<Occupied>(entry).node->value;
+        }
+        return insert_vacant(std::move(value));
+      }
+
+      // like or_insert, but f() is only called when the key is vacant
+      template <typename F>
+      T& or_insert_with(F f) {
+        if (is_occupied()) {
+          return std::get<Occupied>(entry).node->value;
+        }
+        return insert_vacant(f());
+      }
+
+      T& or_default() {
+        if (is_occupied()) {
+          return std::get<Occupied>(entry).node->value;
+        }
+        return insert_vacant();
+      }
+
+      template <typename F>
+      Entry& and_modify(F f) {
+        if (is_occupied()) {
+          f(std::get<Occupied>(entry).node->value);
         }
         return *this;
       }
     };
 
     Entry entry(K key) {
-      std::optional<T> entry = this->get(key);
-      if (entry.has_value()) {
-        return Entry(key, entry.value(), this);
+      uint64_t h = hash(key);
+      return entry(std::move(key), h);
+    }
+
+    // as above, for a key whose hash_of() is already known
+    Entry entry(K key, uint64_t h) {
+      rehash_step(kRehashStep);
+      Node** link = find_link(key, h);
+      if (*link != nullptr) {
+        return Entry(this, *link);
       }
-      return Entry(key, this);
+      return Entry(this, std::move(key), h, link);
     }
 
     class Iterator {
@@ -219,24 +835,20 @@ namespace dsun {
           node = node->next;
           return *this;
         }
-        index++;
-        while (index < map.table.capacity() && map.table.get(index).has_value() == false) {
-          index++;
-        }
-        if (index < map.table.capacity()) {
-          node = map.table.get(index).value();
-        }
+        index = map.next_bucket(index + 1);
+        node = map.bucket_at(index);
         return *this;
       }
 
-      std::pair<K, T> get() const {
+      // views into the node, no copy of the key or value is made
+      std::pair<const K&, const T&> get() const {
         return { node->key, node->value };
       }
-      std::pair<K, T>& get_mut() {
+      std::pair<const K&, T&> get_mut() const {
         return { node->key, node->value };
       }
-      std::pair<K, T> operator*() const {
-        return get();
+      std::pair<const K&, T&> operator*() const {
+        return get_mut();
       }
 
       uint32_t get_index() const {
@@ -244,19 +856,173 @@ namespace dsun {
       }
     };
 
+    // writes every entry to `path`, returns false on an i/o error.
+    //
+    // the file holds the bucket count and one (hash, key, value) record per
+    // entry. load() relinks the records into a table of the same size from
+    // the stored hashes, without hashing or comparing a single key.
+    bool save(const char* path) const
+      requires std::is_trivially_copyable_v<K>&& std::is_trivially_copyable_v<T> {
+      table_file::Header header = file_header();
+      header.capacity = std::max(table.count, kMinBuckets);
+      header.len = len_;
+      header.records_offset = table_file::align_up(sizeof(header));
+      header.file_size = header.records_offset + len_ * sizeof(Record);
+      table_file::Writer writer(path);
+      writer.write(&header, sizeof(header));
+      writer.pad_to(header.records_offset);
+      for_each_node([&](const Node* node) {
+        Record record{ node->hash, node->key, node->value };
+        writer.write(&record, sizeof(record));
+        });
+      return writer.finish();
+    }
+
+    // a map saved by save(), or nullopt if the file is missing, truncated
+    // or was written for other key / value types or another hasher
+    static std::optional<HashMap<K, T>> load(const char* path)
+      requires std::is_trivially_copyable_v<K>&& std::is_trivially_copyable_v<T> {
+      auto file = table_file::Mapping::open(path);
+      if (!file.has_value()) {
+        return std::nullopt;
+      }
+      auto header = table_file::read_header(file->data(), file->size(), file_header());
+      // len is bounded first, so len * sizeof(Record) cannot wrap
+      if (!header.has_value() || header->capacity < kMinBuckets || !std::has_single_bit(header->capacity)
+        || header->len > header->file_size / sizeof(Record)
+        || !table_file::fits(*header, header->records_offset, header->len * sizeof(Record))) {
+        return std::nullopt;
+      }
+      // sized from len rather than the stored capacity, which a corrupt
+      // header could make too large to allocate
+      HashMap<K, T> map;
+      map.table = Buckets(buckets_for(header->len, map.max_load_));
+      // the records section is aligned in the file, and so in the mapping
+      const Record* records = reinterpret_cast<const Record*>(file->data() + header->records_offset);
+      for (uint64_t i = 0; i < header->len; i++) {
+        const Record& record = records[i];
+        Node*& head = map.table[map.table.index(record.hash)];
+        Node* node = map.pool.create(record.hash, record.key, record.value);
+        node->next = head;
+        head = node;
+      }
+      map.len_ = header->len;
+      return map;
+    }
+
+    // out[i] is the value for keys[i], or nullptr. the keys are resolved
+    // kLookupBatch at a time: all their buckets are prefetched, then all
+    // their first nodes, and only then are the chains walked, so the cache
+    // misses of a batch overlap instead of being paid one after another.
+    void get_many(std::span<const K> keys, std::span<const T*> out) const {
+      lookup_many(keys, [&](size_t i, const Node* node) {
+        out[i] = node == nullptr ? nullptr : &node->value;
+        });
+    }
+
+    // out[i] says whether keys[i] is present. returns how many are.
+    size_t contains_many(std::span<const K> keys, std::span<bool> out) const {
+      size_t found = 0;
+      lookup_many(keys, [&](size_t i, const Node* node) {
+        out[i] = node != nullptr;
+        found += node != nullptr;
+        });
+      return found;
+    }
+
+    // calls f(key, value) for every entry, without going through an Iterator
+    template <typename F>
+    void for_each(F f) const {
+      for_each_node([&](const Node* node) {
+        f(node->key, std::as_const(node->value));
+        });
+    }
+
     Iterator begin() {
-      uint32_t index = 0;
-      while (index < table.capacity() && table.get(index).has_value() == false) {
+      uint32_t index = next_bucket(0);
+      return Iterator(*this, index, bucket_at(index));
+    }
+
+    Iterator end() {
+      return Iterator(*this, bucket_span(), nullptr);
+    }
+
+  private:
+    // iteration covers the new bucket array followed by the old one
+    uint32_t bucket_span() const {
+      return static_cast<uint32_t>(table.count + old_table.count);
+    }
+
+    Node* bucket_at(uint32_t index) const {
+      if (index < table.count) {
+        return table[index];
+      }
+      if (index < bucket_span()) {
+        return old_table[index - table.count];
+      }
+      return nullptr;
+    }
+
+    uint32_t next_bucket(uint32_t index) const {
+      while (index < bucket_span() && bucket_at(index) == nullptr) {
         index++;
       }
-      if (index < table.capacity()) {
-        return Iterator(*this, index, table.get(index).value());
+      return index;
+    }
+
+    // 2: the header records the hasher
+    static constexpr uint32_t kFileVersion = 2;
+
+    struct Record {
+      uint64_t hash;
+      K key;
+      T value;
+    };
+
+    static table_file::Header file_header() {
+      auto header = table_file::make_header("DSUNHMAP", kFileVersion, sizeof(K), sizeof(T), sizeof(Record));
+      header.hasher_id = table_file::hasher_id<K>(Hash<K>{});
+      return header;
+    }
+
+    static constexpr size_t kLookupBatch = 16;
+
+    template <typename F>
+    void lookup_many(std::span<const K> keys, F on_result) const {
+      uint64_t hashes[kLookupBatch];
+      Node* heads[kLookupBatch];
+      for (size_t start = 0; start < keys.size(); start += kLookupBatch) {
+        size_t count = std::min(kLookupBatch, keys.size() - start);
+        for (size_t i = 0; i < count; i++) {
+          hashes[i] = hash(keys[start + i]);
+          prefetch(&bucket(hashes[i]));
+        }
+        for (size_t i = 0; i < count; i++) {
+          heads[i] = bucket(hashes[i]);
+          prefetch(heads[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+          Node* node = heads[i];
+          uint64_t probes = 0;
+          for (; node != nullptr; node = node->next) {
+            probes++;
+            if (node->hash == hashes[i] && node->key == keys[start + i]) {
+              break;
+            }
+          }
+          counters.record(node != nullptr, probes);
+          on_result(start + i, node);
+        }
       }
-      return Iterator(*this, index, nullptr);
     }
 
-    Iterator end() {
-      return Iterator(*this, table.capacity(), nullptr);
+    template <typename F>
+    void for_each_node(F f) const {
+      for (uint32_t i = 0; i < bucket_span(); i++) {
+        for (Node* node = bucket_at(i); node != nullptr; node = node->next) {
+          f(node);
+        }
+      }
     }
   };
 }
@@ -0,0 +1,120 @@
+#ifndef DSUN_HASH_STATS_H
+#define DSUN_HASH_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 1 makes HashMap and the swiss tables count the probe length of every
+// lookup, reported by their stats(). left at 0 the counters are empty
+// members and the calls that feed them compile to nothing. a table type
+// changes layout with the switch, so set it the same for every
+// translation unit that uses the table.
+#ifndef DSUN_HASH_STATS
+#define DSUN_HASH_STATS 0
+#endif
+
+namespace dsun {
+
+  // probe lengths over a set of lookups
+  struct ProbeStats {
+    uint64_t lookups = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    [[nodiscard]] double average() const {
+      return lookups == 0 ? 0 : static_cast<double>(total) / static_cast<double>(lookups);
+    }
+  };
+
+  // a snapshot of a hash table's shape, from stats(). a probe is one group
+  // for the swiss tables and one chain node for HashMap.
+  struct TableStats {
+    size_t len = 0;
+    // slots, or buckets for HashMap
+    size_t capacity = 0;
+    double load_factor = 0;
+    // deleted slots still on probe paths, always 0 for HashMap
+    size_t tombstones = 0;
+    // swiss tables: probe_lengths[i] keys found after probing i + 1 groups
+    std::vector<size_t> probe_lengths;
+    // HashMap: chain_lengths[i] buckets holding i nodes
+    std::vector<size_t> chain_lengths;
+    // heap memory held by the table, 0 for a table mapped from a file
+    size_t bytes_allocated = 0;
+    // lookups (insert and erase included) since the table was made or
+    // reset_stats() was called; all zero unless DSUN_HASH_STATS is 1
+    ProbeStats hits;
+    ProbeStats misses;
+  };
+
+  namespace hash_stats {
+
+    inline void add_to_histogram(std::vector<size_t>& histogram, size_t length) {
+      if (histogram.size() <= length) {
+        histogram.resize(length + 1);
+      }
+      histogram[length]++;
+    }
+
+    // the lookup counters of one table, empty unless Enabled
+    template <bool Enabled = DSUN_HASH_STATS>
+    class LookupCounters {
+    public:
+      void record(bool, uint64_t) const {}
+      void read(TableStats&) const {}
+      void reset() {}
+    };
+
+    // relaxed atomics, since const lookups may run on several threads at
+    // once. the counters belong to the table object: a copy or a moved-to
+    // table starts from zero.
+    template <>
+    class LookupCounters<true> {
+    private:
+      struct Counter {
+        std::atomic<uint64_t> lookups{ 0 };
+        std::atomic<uint64_t> total{ 0 };
+        std::atomic<uint64_t> max{ 0 };
+
+        void add(uint64_t probes) {
+          lookups.fetch_add(1, std::memory_order_relaxed);
+          total.fetch_add(probes, std::memory_order_relaxed);
+          uint64_t seen = max.load(std::memory_order_relaxed);
+          while (seen < probes && !max.compare_exchange_weak(seen, probes, std::memory_order_relaxed)) {}
+        }
+        ProbeStats read() const {
+          return { lookups.load(std::memory_order_relaxed), total.load(std::memory_order_relaxed), max.load(std::memory_order_relaxed) };
+        }
+        void reset() {
+          lookups.store(0, std::memory_order_relaxed);
+          total.store(0, std::memory_order_relaxed);
+          max.store(0, std::memory_order_relaxed);
+        }
+      };
+      mutable Counter hits;
+      mutable Counter misses;
+    public:
+      LookupCounters() = default;
+      LookupCounters(const LookupCounters&) {}
+      LookupCounters& operator=(const LookupCounters&) {
+        return *this;
+      }
+
+      void record(bool hit, uint64_t probes) const {
+        (hit ? hits : misses).add(probes);
+      }
+      void read(TableStats& stats) const {
+        stats.hits = hits.read();
+        stats.misses = misses.read();
+      }
+      void reset() {
+        hits.reset();
+        misses.reset();
+      }
+    };
+  }
+}
+
+#endif // DSUN_HASH_STATS_H
@@ -0,0 +1,134 @@
+#ifndef DSUN_HASHER_H
+#define DSUN_HASHER_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dsun {
+
+  // the hashing primitives behind dsun::Hash.
+  //
+  //   hash_bytes    64-bit hash of a byte range (the wyhash construction:
+  //                 a 64x64 -> 128 bit multiply folded back to 64 bits, over
+  //                 48 bytes per round for long inputs)
+  //   mix           finalizer for a single integer, so identity hashes like
+  //                 std::hash<int> spread over all 64 bits
+  //   hash_combine  folds one more hash into a running one; order matters
+  //
+  // none of these are seeded per process: equal input gives equal output
+  // across runs, which hash tables saved to disk rely on.
+  namespace hashing {
+    static constexpr uint64_t kSecret[4] = {
+      0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+    };
+
+    // full 128-bit product of a and b, low half in a and high half in b
+    inline void multiply(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+      __uint128_t product = static_cast<__uint128_t>(a) * b;
+      a = static_cast<uint64_t>(product);
+      b = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+      a = _umul128(a, b, &b);
+#else
+      uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+      uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+      uint64_t t = rl + (rm0 << 32);
+      uint64_t carry = t < rl;
+      uint64_t lo = t + (rm1 << 32);
+      carry += lo < t;
+      a = lo;
+      b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+    }
+
+    // multiplies and folds the two halves of the product together
+    inline uint64_t fold(uint64_t a, uint64_t b) {
+      multiply(a, b);
+      return a ^ b;
+    }
+
+    inline uint64_t read64(const uint8_t* p) {
+      uint64_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    inline uint64_t read32(const uint8_t* p) {
+      uint32_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    // 1 to 3 bytes, every byte lands in the result
+    inline uint64_t read_small(const uint8_t* p, size_t len) {
+      return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+    }
+  }
+
+  inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed = 0) {
+    using namespace hashing;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= fold(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a;
+    uint64_t b;
+    if (len <= 16) {
+      if (len >= 4) {
+        // two overlapping reads from each end cover every byte
+        a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+        b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+      }
+      else if (len > 0) {
+        a = read_small(p, len);
+        b = 0;
+      }
+      else {
+        a = 0;
+        b = 0;
+      }
+    }
+    else {
+      size_t remaining = len;
+      if (remaining > 48) {
+        uint64_t lane1 = seed;
+        uint64_t lane2 = seed;
+        do {
+          seed = fold(read64(p) ^ kSecret[1], read64(p + 8) ^ seed);
+          lane1 = fold(read64(p + 16) ^ kSecret[2], read64(p + 24) ^ lane1);
+          lane2 = fold(read64(p + 32) ^ kSecret[3], read64(p + 40) ^ lane2);
+          p += 48;
+          remaining -= 48;
+        } while (remaining > 48);
+        seed ^= lane1 ^ lane2;
+      }
+      while (remaining > 16) {
+        seed = fold(read64(p) ^ kSecret[1], read64(p + 8) ^ seed);
+        p += 16;
+        remaining -= 16;
+      }
+      // the last 16 bytes, overlapping what was already consumed
+      a = read64(p + remaining - 16);
+      b = read64(p + remaining - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    multiply(a, b);
+    return fold(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+  }
+
+  inline uint64_t mix(uint64_t value) {
+    return hashing::fold(value ^ hashing::kSecret[0], hashing::kSecret[1]);
+  }
+
+  inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+    return mix(std::rotl(seed, 23) ^ value);
+  }
+}
+
+#endif // DSUN_HASHER_H
@@ -0,0 +1,389 @@
+#ifndef DSUN_INDEX_MAP_H
+#define DSUN_INDEX_MAP_H
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "hash.h"
+#include "hash_stats.h"
+#include "vec.h"
+
+namespace dsun {
+
+  // hash map that remembers insertion order, for small to mid-sized maps
+  // that are iterated a lot (configs, symbol tables).
+  //
+  // the entries (key, value and hash) sit densely in a Vec in the order
+  // they were inserted, so iterating is a walk over one array and the
+  // order is the same on every run. the hash index is a separate
+  // open-addressed table of entry positions, linearly probed and at most
+  // half full. a position takes 1, 2 or 4 bytes, whichever is enough for
+  // the entries the table can hold, so up to 32768 entries the index costs
+  // 4 to 8 bytes per entry. the index is rebuilt from the stored
+  // hashes when it grows, without hashing a key.
+  //
+  // remove() keeps the order and costs O(len); swap_remove() is O(1) and
+  // moves the last entry into the hole. K and V must be default
+  // constructible, since Vec default-constructs its storage.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>>
+  class IndexMap {
+  public:
+    struct Entry {
+      K key;
+      V value;
+      uint64_t hash;
+    };
+
+  private:
+    using Index = std::variant<std::vector<uint8_t>, std::vector<uint16_t>, std::vector<uint32_t>>;
+    static constexpr size_t kMinSlots = 16;
+
+    Vec<Entry> entries_;
+    // entry position + 1 per slot, 0 for a free slot
+    Index index_;
+    size_t mask_ = 0;
+    uint32_t shift_ = 64;
+    [[no_unique_address]] hash_stats::LookupCounters<> counters_;
+
+    template <typename Q>
+    static uint64_t hash_key(const Q& key) {
+      return static_cast<uint64_t>(Hash{}(key));
+    }
+
+    // the key itself when it can be hashed and compared against K,
+    // otherwise a K converted from it
+    template <typename Q>
+    static decltype(auto) lookup_key(const Q& key) {
+      if constexpr (std::same_as<K, Q> || TransparentLookup<K, Q>) {
+        return (key);
+      }
+      else {
+        return static_cast<K>(key);
+      }
+    }
+
+    size_t home(uint64_t hash) const {
+      return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    // calls f on the index vector, whatever its width. a switch rather than
+    // std::visit, so the lookup path has no indirect call.
+    template <typename Self, typename F>
+    static decltype(auto) visit_index(Self& self, F f) {
+      switch (self.index_.index()) {
+      case 0:
+        return f(*std::get_if<0>(&self.index_));
+      case 1:
+        return f(*std::get_if<1>(&self.index_));
+      default:
+        return f(*std::get_if<2>(&self.index_));
+      }
+    }
+
+    // an index of `slots` slots with the narrowest position that fits the
+    // slots / 2 entries it may hold
+    static Index make_index(size_t slots) {
+      if (slots / 2 < UINT8_MAX) {
+        return std::vector<uint8_t>(slots);
+      }
+      if (slots / 2 < UINT16_MAX) {
+        return std::vector<uint16_t>(slots);
+      }
+      return std::vector<uint32_t>(slots);
+    }
+
+    size_t slot_count() const {
+      return mask_ + 1;
+    }
+
+    void rebuild_index(size_t slots) {
+      index_ = make_index(slots);
+      mask_ = slots - 1;
+      shift_ = 64 - std::countr_zero(slots);
+      for (uint32_t i = 0; i < entries_.len(); i++) {
+        place(entries_[i].hash, i);
+      }
+    }
+
+    void place(uint64_t hash, size_t position) {
+      visit_index(*this, [&](auto& slots) {
+        size_t i = home(hash);
+        while (slots[i] != 0) {
+          i = (i + 1) & mask_;
+        }
+        slots[i] = static_cast<std::remove_reference_t<decltype(slots[i])>>(position + 1);
+        });
+    }
+
+    struct Found {
+      size_t slot;
+      size_t position;
+    };
+
+    template <typename Q>
+    std::optional<Found> locate(const Q& key, uint64_t hash) const {
+      return visit_index(*this, [&](const auto& slots) -> std::optional<Found> {
+        uint64_t probes = 0;
+        for (size_t i = home(hash);; i = (i + 1) & mask_) {
+          size_t stored = slots[i];
+          probes++;
+          if (stored == 0) {
+            counters_.record(false, probes);
+            return std::nullopt;
+          }
+          const Entry& entry = entries_[static_cast<uint32_t>(stored - 1)];
+          if (entry.hash == hash && entry.key == key) {
+            counters_.record(true, probes);
+            return Found{ i, stored - 1 };
+          }
+        }
+        });
+    }
+
+    template <typename Q>
+    std::optional<Found> locate(const Q& key) const {
+      const auto& lookup = lookup_key(key);
+      return locate(lookup, hash_key(lookup));
+    }
+
+    // frees a slot by shifting the rest of its probe run back, so linear
+    // probing needs no tombstones
+    void erase_slot(size_t hole) {
+      visit_index(*this, [&](auto& slots) {
+        size_t i = (hole + 1) & mask_;
+        while (slots[i] != 0) {
+          size_t wanted = home(entries_[static_cast<uint32_t>(slots[i] - 1)].hash);
+          // the entry at i may move to the hole if the hole is not before its home
+          if (((i - wanted) & mask_) >= ((i - hole) & mask_)) {
+            slots[hole] = slots[i];
+            hole = i;
+          }
+          i = (i + 1) & mask_;
+        }
+        slots[hole] = 0;
+        });
+    }
+
+    // points the slot of the entry at `from` to `to`
+    void repoint(size_t from, size_t to) {
+      visit_index(*this, [&](auto& slots) {
+        size_t i = home(entries_[static_cast<uint32_t>(from)].hash);
+        while (slots[i] != from + 1) {
+          i = (i + 1) & mask_;
+        }
+        slots[i] = static_cast<std::remove_reference_t<decltype(slots[i])>>(to + 1);
+        });
+    }
+
+    // Vec only lowers its length, so the vacated entry is reset here to
+    // release what its key and value hold
+    void drop_last() {
+      uint32_t last = entries_.len() - 1;
+      entries_[last] = Entry{};
+      entries_.set_len(static_cast<int>(last));
+    }
+
+  public:
+    IndexMap() : IndexMap(0) {}
+
+    // room for `capacity` entries before the first growth
+    explicit IndexMap(size_t capacity) : entries_(static_cast<uint32_t>(std::max<size_t>(capacity, 16))) {
+      rebuild_index(std::bit_ceil(std::max(kMinSlots, capacity * 2)));
+    }
+
+    // inserts the pair at the end, or replaces the value of the key in
+    // place. returns true if the key was new.
+    bool insert(const K& key, V value) {
+      uint64_t hash = hash_key(key);
+      if (auto found = locate(key, hash)) {
+        entries_[static_cast<uint32_t>(found->position)].value = std::move(value);
+        return false;
+      }
+      if ((entries_.len() + 1) * 2 > slot_count()) {
+        rebuild_index(slot_count() * 2);
+      }
+      entries_.push(Entry{ key, std::move(value), hash });
+      place(hash, entries_.len() - 1);
+      return true;
+    }
+
+    // removes the entry and closes the gap, keeping the order. O(len).
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<V> remove(const Q& key) {
+      auto found = locate(key);
+      if (!found.has_value()) {
+        return std::nullopt;
+      }
+      erase_slot(found->slot);
+      uint32_t position = static_cast<uint32_t>(found->position);
+      std::optional<V> value(std::move(entries_[position].value));
+      for (uint32_t i = position + 1; i < entries_.len(); i++) {
+        entries_[i - 1] = std::move(entries_[i]);
+      }
+      drop_last();
+      visit_index(*this, [&](auto& slots) {
+        for (auto& slot : slots) {
+          slot -= slot > position + 1;
+        }
+        });
+      return value;
+    }
+
+    // removes the entry by moving the last one into its place. O(1).
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<V> swap_remove(const Q& key) {
+      auto found = locate(key);
+      if (!found.has_value()) {
+        return std::nullopt;
+      }
+      erase_slot(found->slot);
+      uint32_t position = static_cast<uint32_t>(found->position);
+      uint32_t last = entries_.len() - 1;
+      std::optional<V> value(std::move(entries_[position].value));
+      if (position != last) {
+        repoint(last, position);
+        entries_[position] = std::move(entries_[last]);
+      }
+      drop_last();
+      return value;
+    }
+
+    // pointer to the value for `key`, or nullptr
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    V* find(const Q& key) {
+      auto found = locate(key);
+      return found.has_value() ? &entries_[static_cast<uint32_t>(found->position)].value : nullptr;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    const V* find(const Q& key) const {
+      auto found = locate(key);
+      return found.has_value() ? &entries_[static_cast<uint32_t>(found->position)].value : nullptr;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<V> get(const Q& key) const {
+      const V* value = find(key);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      return *value;
+    }
+
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    bool contains_key(const Q& key) const {
+      return locate(key).has_value();
+    }
+
+    // the position of the key in insertion order
+    template <typename Q = K>
+      requires LookupKey<K, Q>
+    std::optional<size_t> index_of(const Q& key) const {
+      auto found = locate(key);
+      if (!found.has_value()) {
+        return std::nullopt;
+      }
+      return found->position;
+    }
+
+    // the entry at `position` in insertion order; position < len()
+    std::pair<const K&, V&> at(size_t position) {
+      Entry& entry = entries_[static_cast<uint32_t>(position)];
+      return { entry.key, entry.value };
+    }
+
+    std::pair<const K&, const V&> at(size_t position) const {
+      const Entry& entry = entries_[static_cast<uint32_t>(position)];
+      return { entry.key, entry.value };
+    }
+
+    [[nodiscard]] size_t len() const {
+      return entries_.len();
+    }
+
+    [[nodiscard]] bool is_empty() const {
+      return entries_.len() == 0;
+    }
+
+    // makes room for `capacity` entries without growing the index
+    void reserve(size_t capacity) {
+      if (capacity * 2 > slot_count()) {
+        rebuild_index(std::bit_ceil(capacity * 2));
+      }
+    }
+
+    // removes every entry, keeping the index size
+    void clear() {
+      for (uint32_t i = 0; i < entries_.len(); i++) {
+        entries_[i] = Entry{};
+      }
+      entries_.clear();
+      visit_index(*this, [](auto& slots) {
+        std::fill(slots.begin(), slots.end(), 0);
+        });
+    }
+
+    // calls f(key, value) for every entry in insertion order
+    template <typename F>
+    void for_each(F f) const {
+      for (const Entry& entry : *this) {
+        f(entry.key, entry.value);
+      }
+    }
+
+    // like for_each, with the values writable
+    template <typename F>
+    void for_each_mut(F f) {
+      for (uint32_t i = 0; i < entries_.len(); i++) {
+        f(std::as_const(entries_[i].key), entries_[i].value);
+      }
+    }
+
+    // the entries in insertion order, as one contiguous array
+    const Entry* begin() const {
+      return &entries_[0];
+    }
+    const Entry* end() const {
+      return begin() + entries_.len();
+    }
+
+    // load, probe lengths and memory, see TableStats. capacity is in index
+    // slots, and a probe is one slot.
+    TableStats stats() const {
+      TableStats stats;
+      stats.len = len();
+      stats.capacity = slot_count();
+      stats.load_factor = static_cast<double>(len()) / static_cast<double>(slot_count());
+      visit_index(*this, [&](const auto& slots) {
+        for (size_t i = 0; i < slots.size(); i++) {
+          if (slots[i] != 0) {
+            size_t wanted = home(entries_[static_cast<uint32_t>(slots[i] - 1)].hash);
+            hash_stats::add_to_histogram(stats.probe_lengths, (i - wanted) & mask_);
+          }
+        }
+        stats.bytes_allocated = entries_.capacity() * sizeof(Entry) + slots.size() * sizeof(slots[0]);
+        });
+      counters_.read(stats);
+      return stats;
+    }
+
+    // zeroes the lookup counters of stats()
+    void reset_stats() {
+      counters_.reset();
+    }
+  };
+}
+
+#endif // DSUN_INDEX_MAP_H
@@ -220,6 +220,169 @@ namespace dsun {
       return list;
     }
 
+    /// moves every node of `other` to the end of this list, leaving `other` empty.
+    /// nodes are relinked, no element is copied.
+    void append(LinkedList<T>& other) {
+      if (&other == this || other.is_empty()) {
+        return;
+      }
+      if (is_empty()) {
+        head = other.head;
+      }
+      else {
+        tail.value()->next = other.head;
+        other.head.value()->prev = tail;
+      }
+      tail = other.tail;
+      size += other.size;
+      other.reset();
+    }
+
+    /// moves every node of `other` in front of the element at `pos`, leaving `other` empty.
+    /// finding `pos` walks from the closer end, the relinking itself is O(1).
+    void splice(size_t pos, LinkedList<T>& other) {
+      if (pos > size) {
+        throw std::out_of_range("Index out of range: " + dsun_utils::to_string(pos));
+      }
+      if (&other == this || other.is_empty()) {
+        return;
+      }
+      if (pos == size) {
+        append(other);
+        return;
+      }
+      auto next = node_at(pos);
+      auto prev = next.value()->prev;
+      if (prev.has_value()) {
+        prev.value()->next = other.head;
+      }
+      else {
+        head = other.head;
+      }
+      other.head.value()->prev = prev;
+      other.tail.value()->next = next;
+      next.value()->prev = other.tail;
+      size += other.size;
+      other.reset();
+    }
+
+    /// splits the list in two at `at`: this list keeps [0, at) and the
+    /// returned list owns [at, len).
+    LinkedList<T> split_off(size_t at) {
+      if (at > size) {
+        throw std::out_of_range("Index out of range: " + dsun_utils::to_string(at));
+      }
+      LinkedList<T> rest;
+      if (at == size) {
+        return rest;
+      }
+      if (at == 0) {
+        rest.append(*this);
+        return rest;
+      }
+      auto first = node_at(at);
+      rest.head = first;
+      rest.tail = tail;
+      rest.size = size - at;
+      tail = first.value()->prev;
+      tail.value()->next = std::nullopt;
+      first.value()->prev = std::nullopt;
+      size = at;
+      return rest;
+    }
+
+    /// merges the sorted list `other` into this sorted list, leaving `other` empty.
+    /// the merge is stable: on ties, elements of this list come first.
+    template <typename Compare = std::less<T>>
+    void merge(LinkedList<T>& other, Compare cmp = Compare()) {
+      if (&other == this || other.is_empty()) {
+        return;
+      }
+      if (is_empty()) {
+        append(other);
+        return;
+      }
+      node_ptr_opt a = head;
+      node_ptr_opt b = other.head;
+      node_ptr_opt merged = std::nullopt;
+      node_ptr_opt last = std::nullopt;
+      while (a.has_value() && b.has_value()) {
+        node_ptr_opt next;
+        if (cmp(b.value()->data, a.value()->data)) {
+          next = b;
+          b = b.value()->next;
+        }
+        else {
+          next = a;
+          a = a.value()->next;
+        }
+        link_sorted(merged, last, next);
+      }
+      node_ptr_opt rest = a.has_value() ? a : b;
+      last.value()->next = rest;
+      rest.value()->prev = last;
+      if (b.has_value()) {
+        tail = other.tail;
+      }
+      head = merged;
+      size += other.size;
+      other.reset();
+    }
+
+    /// stable in-place merge sort. nodes are relinked, no element is copied,
+    /// and no extra memory is allocated.
+    template <typename Compare = std::less<T>>
+    void sort(Compare cmp = Compare()) {
+      if (size < 2) {
+        return;
+      }
+      // bottom-up merge of runs of doubling length
+      size_t run = 1;
+      while (true) {
+        node_ptr_opt p = head;
+        node_ptr_opt merged = std::nullopt;
+        node_ptr_opt last = std::nullopt;
+        size_t merges = 0;
+        while (p.has_value()) {
+          merges++;
+          node_ptr_opt q = p;
+          size_t p_len = 0;
+          while (p_len < run && q.has_value()) {
+            p_len++;
+            q = q.value()->next;
+          }
+          size_t q_len = run;
+          while (p_len > 0 || (q_len > 0 && q.has_value())) {
+            node_ptr_opt next;
+            if (p_len == 0) {
+              next = q;
+              q = q.value()->next;
+              q_len--;
+            }
+            else if (q_len == 0 || !q.has_value() || !cmp(q.value()->data, p.value()->data)) {
+              next = p;
+              p = p.value()->next;
+              p_len--;
+            }
+            else {
+              next = q;
+              q = q.value()->next;
+              q_len--;
+            }
+            link_sorted(merged, last, next);
+          }
+          p = q;
+        }
+        last.value()->next = std::nullopt;
+        head = merged;
+        tail = last;
+        if (merges <= 1) {
+          return;
+        }
+        run *= 2;
+      }
+    }
+
     class Iterator {
     private:
       node_ptr_opt current;
@@ -302,6 +465,40 @@ namespace dsun {
     };
 
 
+    void reset() {
+      head = std::nullopt;
+      tail = std::nullopt;
+      size = 0;
+    }
+
+    // walks from the closer end to the node at `index`, which must be < size
+    node_ptr_opt node_at(size_t index) const {
+      if (index <= size / 2) {
+        node_ptr_opt node = head;
+        for (size_t i = 0; i < index; i++) {
+          node = node.value()->next;
+        }
+        return node;
+      }
+      node_ptr_opt node = tail;
+      for (size_t i = size - 1; i > index; i--) {
+        node = node.value()->prev;
+      }
+      return node;
+    }
+
+    // appends `node` to the chain being built by merge/sort
+    static void link_sorted(node_ptr_opt& first, node_ptr_opt& last, const node_ptr_opt& node) {
+      if (last.has_value()) {
+        last.value()->next = node;
+      }
+      else {
+        first = node;
+      }
+      node.value()->prev = last;
+      last = node;
+    }
+
     void push_back_node(node_ptr_opt node) {
       if (is_empty()) {
         head = node;
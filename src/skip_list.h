@@ -0,0 +1,366 @@
+#ifndef DSUN_SKIP_LIST_H
+#define DSUN_SKIP_LIST_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "bstree.h"
+#include "epoch.h"
+
+namespace dsun {
+
+  // ordered map safe for concurrent insert / remove / find.
+  //
+  // this is the lazy skip list of Herlihy, Lev, Luchangco and Shavit:
+  //   - find, contains, lower_bound and iteration take no lock
+  //   - insert and remove lock only the predecessors of the node they touch,
+  //     so writers on different parts of the key space never contend
+  //   - remove first marks the node (logical delete) and then unlinks it
+  //
+  // values are immutable once inserted, readers get copies. unlinked nodes
+  // are reclaimed through dsun::epoch, since a lock-free reader may still
+  // be standing on them.
+  template <Comparable K, typename V>
+  class SkipListMap {
+  private:
+    static constexpr int kMaxHeight = 24;
+
+    struct Node {
+      std::mutex lock;
+      std::atomic<bool> marked{ false };
+      std::atomic<bool> fully_linked{ false };
+      int height;
+      alignas(std::pair<K, V>) unsigned char storage[sizeof(std::pair<K, V>)];
+
+      explicit Node(int height) : height(height) {}
+
+      std::atomic<Node*>* next() {
+        return reinterpret_cast<std::atomic<Node*>*>(reinterpret_cast<unsigned char*>(this) + sizeof(Node));
+      }
+      std::pair<K, V>& entry() {
+        return *std::launder(reinterpret_cast<std::pair<K, V>*>(storage));
+      }
+      const K& key() {
+        return entry().first;
+      }
+
+      // the tower of next pointers lives in the same allocation, right after the node
+      static Node* create(int height) {
+        void* memory = ::operator new(sizeof(Node) + height * sizeof(std::atomic<Node*>));
+        Node* node = new (memory) Node(height);
+        for (int i = 0; i < height; i++) {
+          new (&node->next()[i]) std::atomic<Node*>(nullptr);
+        }
+        return node;
+      }
+      static Node* create(int height, const K& key, const V& value) {
+        Node* node = create(height);
+        new (node->storage) std::pair<K, V>(key, value);
+        return node;
+      }
+      static void destroy(Node* node, bool has_entry = true) {
+        if (has_entry) {
+          node->entry().~pair();
+        }
+        node->~Node();
+        ::operator delete(node);
+      }
+      static void destroy_retired(void* node) {
+        destroy(static_cast<Node*>(node));
+      }
+    };
+
+    // head is a sentinel smaller than every key, nullptr acts as +infinity
+    Node* head;
+    std::atomic<size_t> len_{ 0 };
+
+    static bool less(const K& a, const K& b) {
+      return (a <=> b) < 0;
+    }
+
+    static int random_height() {
+      thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      // geometric distribution with p = 1/2
+      int height = 1 + std::countr_zero(state | (1ull << (kMaxHeight - 1)));
+      return height;
+    }
+
+    // fills preds/succs for every level and returns the highest level at
+    // which a node with `key` was found, or -1
+    int find_node(const K& key, Node** preds, Node** succs) {
+      int found = -1;
+      Node* pred = head;
+      for (int level = kMaxHeight - 1; level >= 0; level--) {
+        Node* curr = pred->next()[level].load(std::memory_order_acquire);
+        while (curr != nullptr && less(curr->key(), key)) {
+          pred = curr;
+          curr = pred->next()[level].load(std::memory_order_acquire);
+        }
+        if (found == -1 && curr != nullptr && !less(key, curr->key())) {
+          found = level;
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+      }
+      return found;
+    }
+
+    // first live node whose key is not less than `key`
+    Node* lower_bound_node(const K& key) {
+      Node* pred = head;
+      Node* curr = nullptr;
+      for (int level = kMaxHeight - 1; level >= 0; level--) {
+        curr = pred->next()[level].load(std::memory_order_acquire);
+        while (curr != nullptr && less(curr->key(), key)) {
+          pred = curr;
+          curr = pred->next()[level].load(std::memory_order_acquire);
+        }
+      }
+      return skip_dead(curr);
+    }
+
+    static Node* skip_dead(Node* node) {
+      while (node != nullptr && (node->marked.load(std::memory_order_acquire) || !node->fully_linked.load(std::memory_order_acquire))) {
+        node = node->next()[0].load(std::memory_order_acquire);
+      }
+      return node;
+    }
+
+    static void unlock_preds(Node** preds, int highest_locked) {
+      Node* prev = nullptr;
+      for (int level = 0; level <= highest_locked; level++) {
+        if (preds[level] != prev) {
+          preds[level]->lock.unlock();
+          prev = preds[level];
+        }
+      }
+    }
+
+  public:
+    SkipListMap() : head(Node::create(kMaxHeight)) {}
+
+    SkipListMap(const SkipListMap&) = delete;
+    SkipListMap& operator=(const SkipListMap&) = delete;
+
+    ~SkipListMap() {
+      Node* node = head->next()[0].load(std::memory_order_relaxed);
+      while (node != nullptr) {
+        Node* next = node->next()[0].load(std::memory_order_relaxed);
+        Node::destroy(node);
+        node = next;
+      }
+      Node::destroy(head, false);
+    }
+
+    // returns false if the key is already present
+    bool insert(const K& key, const V& value) {
+      int height = random_height();
+      Node* preds[kMaxHeight];
+      Node* succs[kMaxHeight];
+      auto guard = epoch::pin();
+      while (true) {
+        int found = find_node(key, preds, succs);
+        if (found != -1) {
+          Node* existing = succs[found];
+          if (!existing->marked.load(std::memory_order_acquire)) {
+            // wait for a concurrent insert of the same key to finish
+            while (!existing->fully_linked.load(std::memory_order_acquire)) {
+              std::this_thread::yield();
+            }
+            return false;
+          }
+          // being removed, retry once it is unlinked
+          continue;
+        }
+
+        int highest_locked = -1;
+        bool valid = true;
+        Node* prev = nullptr;
+        for (int level = 0; valid && level < height; level++) {
+          Node* pred = preds[level];
+          Node* succ = succs[level];
+          if (pred != prev) {
+            pred->lock.lock();
+            highest_locked = level;
+            prev = pred;
+          }
+          valid = !pred->marked.load(std::memory_order_acquire)
+            && (succ == nullptr || !succ->marked.load(std::memory_order_acquire))
+            && pred->next()[level].load(std::memory_order_acquire) == succ;
+        }
+        if (!valid) {
+          unlock_preds(preds, highest_locked);
+          continue;
+        }
+
+        Node* node = Node::create(height, key, value);
+        for (int level = 0; level < height; level++) {
+          node->next()[level].store(succs[level], std::memory_order_relaxed);
+        }
+        for (int level = 0; level < height; level++) {
+          preds[level]->next()[level].store(node, std::memory_order_release);
+        }
+        node->fully_linked.store(true, std::memory_order_release);
+        unlock_preds(preds, highest_locked);
+        len_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+
+    std::optional<V> remove(const K& key) {
+      Node* preds[kMaxHeight];
+      Node* succs[kMaxHeight];
+      Node* victim = nullptr;
+      bool is_marked = false;
+      auto guard = epoch::pin();
+      while (true) {
+        int found = find_node(key, preds, succs);
+        if (!is_marked) {
+          if (found == -1) {
+            return std::nullopt;
+          }
+          victim = succs[found];
+          bool deletable = victim->fully_linked.load(std::memory_order_acquire)
+            && victim->height - 1 == found
+            && !victim->marked.load(std::memory_order_acquire);
+          if (!deletable) {
+            return std::nullopt;
+          }
+          victim->lock.lock();
+          if (victim->marked.load(std::memory_order_acquire)) {
+            victim->lock.unlock();
+            return std::nullopt;
+          }
+          victim->marked.store(true, std::memory_order_release);
+          is_marked = true;
+        }
+
+        int highest_locked = -1;
+        bool valid = true;
+        Node* prev = nullptr;
+        for (int level = 0; valid && level < victim->height; level++) {
+          Node* pred = preds[level];
+          if (pred != prev) {
+            pred->lock.lock();
+            highest_locked = level;
+            prev = pred;
+          }
+          valid = !pred->marked.load(std::memory_order_acquire)
+            && pred->next()[level].load(std::memory_order_acquire) == victim;
+        }
+        if (!valid) {
+          unlock_preds(preds, highest_locked);
+          continue;
+        }
+
+        for (int level = victim->height - 1; level >= 0; level--) {
+          preds[level]->next()[level].store(victim->next()[level].load(std::memory_order_acquire), std::memory_order_release);
+        }
+        V value = victim->entry().second;
+        victim->lock.unlock();
+        unlock_preds(preds, highest_locked);
+        len_.fetch_sub(1, std::memory_order_relaxed);
+        epoch::retire(victim, Node::destroy_retired);
+        return value;
+      }
+    }
+
+    std::optional<V> find(const K& key) {
+      auto guard = epoch::pin();
+      Node* node = lower_bound_node(key);
+      if (node == nullptr || less(key, node->key())) {
+        return std::nullopt;
+      }
+      return node->entry().second;
+    }
+
+    bool contains(const K& key) {
+      auto guard = epoch::pin();
+      Node* node = lower_bound_node(key);
+      return node != nullptr && !less(key, node->key());
+    }
+
+    // first entry whose key is not less than `key`
+    std::optional<std::pair<K, V>> lower_bound(const K& key) {
+      auto guard = epoch::pin();
+      Node* node = lower_bound_node(key);
+      if (node == nullptr) {
+        return std::nullopt;
+      }
+      return node->entry();
+    }
+
+    std::optional<std::pair<K, V>> first() {
+      auto guard = epoch::pin();
+      Node* node = skip_dead(head->next()[0].load(std::memory_order_acquire));
+      if (node == nullptr) {
+        return std::nullopt;
+      }
+      return node->entry();
+    }
+
+    // calls f(key, value) for the entries in [from, to), in key order.
+    // weakly consistent: entries inserted or removed during the walk may or
+    // may not be visited.
+    template <typename F>
+    void range(const K& from, const K& to, F f) {
+      auto guard = epoch::pin();
+      for (Node* node = lower_bound_node(from); node != nullptr && less(node->key(), to);
+        node = skip_dead(node->next()[0].load(std::memory_order_acquire))) {
+        f(node->entry().first, node->entry().second);
+      }
+    }
+
+    // approximate while writers are running
+    [[nodiscard]] size_t len() const {
+      return len_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool is_empty() const {
+      return len() == 0;
+    }
+
+    // weakly consistent forward iterator over the live entries. it keeps the
+    // thread pinned while alive, so it must stay on the thread that made it.
+    class Iterator {
+    private:
+      Node* node;
+      std::optional<epoch::Guard> guard;
+    public:
+      Iterator(Node* node, std::optional<epoch::Guard> guard) : node(node), guard(std::move(guard)) {}
+      std::pair<K, V> operator*() const {
+        return node->entry();
+      }
+      Iterator& operator++() {
+        node = skip_dead(node->next()[0].load(std::memory_order_acquire));
+        return *this;
+      }
+      bool operator==(const Iterator& other) const {
+        return node == other.node;
+      }
+      bool operator!=(const Iterator& other) const {
+        return node != other.node;
+      }
+    };
+
+    Iterator begin() {
+      auto guard = epoch::pin();
+      Node* first = skip_dead(head->next()[0].load(std::memory_order_acquire));
+      return Iterator(first, std::move(guard));
+    }
+    Iterator end() {
+      return Iterator(nullptr, std::nullopt);
+    }
+  };
+}
+
+#endif // DSUN_SKIP_LIST_H
@@ -0,0 +1,180 @@
+#ifndef DSUN_SNAPSHOT_MAP_H
+#define DSUN_SNAPSHOT_MAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include "epoch.h"
+#include "hash.h"
+#include "swiss_table.h"
+
+namespace dsun {
+
+  // map for read-mostly tables: readers never lock and never write to
+  // memory shared with other threads.
+  //
+  // the contents live in an immutable FlatHashMap snapshot published
+  // through an atomic pointer. a reader pins itself (a store to its own
+  // epoch record), loads the pointer and probes the snapshot. writers
+  // collect their changes in a Batch, build a complete new snapshot from the
+  // current one plus the batch, swap the pointer and hand the old snapshot
+  // to dsun::epoch, which frees it once no reader can still be using it.
+  //
+  // a write costs a full copy of the table, so batch as many changes as
+  // possible into one publish().
+  template <typename K, typename V>
+  class SnapshotMap {
+  private:
+    using Table = SwissTables::FlatHashMap<K, V>;
+
+    struct Snapshot {
+      Table table;
+      explicit Snapshot(size_t capacity) : table(capacity) {}
+      static void destroy_retired(void* snapshot) {
+        delete static_cast<Snapshot*>(snapshot);
+      }
+    };
+
+    // written only by publish, so readers keep it in a shared cache line
+    alignas(64) std::atomic<const Snapshot*> current;
+    std::mutex writer;
+
+    // sized to stay at most half full, so building one never rehashes
+    static size_t capacity_for(size_t len) {
+      return std::bit_ceil(std::max<size_t>(16, len * 2));
+    }
+
+  public:
+    // pending changes for the next snapshot; the last change to a key wins
+    class Batch {
+    private:
+      friend class SnapshotMap;
+      HashMap<K, std::optional<V>> changes;
+      size_t inserts = 0;
+    public:
+      void insert(const K& key, const V& value) {
+        inserts++;
+        changes.insert(key, value);
+      }
+      void remove(const K& key) {
+        changes.insert(key, std::nullopt);
+      }
+      [[nodiscard]] bool is_empty() const {
+        return changes.len() == 0;
+      }
+    };
+
+    // a pinned, consistent view of one snapshot. pointers from find stay
+    // valid while the view is alive. it keeps the thread pinned, holding
+    // back reclamation, so keep it short and on the thread that made it.
+    class View {
+    private:
+      epoch::Guard guard;
+      const Snapshot* snapshot;
+    public:
+      View(epoch::Guard guard, const Snapshot* snapshot) : guard(std::move(guard)), snapshot(snapshot) {}
+
+      const V* find(const K& key) const {
+        return snapshot->table.find(key);
+      }
+      bool contains_key(const K& key) const {
+        return snapshot->table.contains(key);
+      }
+      [[nodiscard]] size_t len() const {
+        return snapshot->table.len();
+      }
+      template <typename F>
+      void for_each(F f) const {
+        for (auto& slot : snapshot->table) {
+          f(slot.key, slot.value);
+        }
+      }
+    };
+
+    SnapshotMap() : current(new Snapshot(capacity_for(0))) {}
+
+    SnapshotMap(const SnapshotMap&) = delete;
+    SnapshotMap& operator=(const SnapshotMap&) = delete;
+
+    // no reader may be using the map
+    ~SnapshotMap() {
+      delete current.load(std::memory_order_relaxed);
+    }
+
+    std::optional<V> get(const K& key) const {
+      auto guard = epoch::pin();
+      const V* value = current.load(std::memory_order_acquire)->table.find(key);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      return *value;
+    }
+
+    bool contains_key(const K& key) const {
+      auto guard = epoch::pin();
+      return current.load(std::memory_order_acquire)->table.contains(key);
+    }
+
+    [[nodiscard]] size_t len() const {
+      auto guard = epoch::pin();
+      return current.load(std::memory_order_acquire)->table.len();
+    }
+
+    // pins the current snapshot, for several reads without a pin each
+    View view() const {
+      auto guard = epoch::pin();
+      return View(std::move(guard), current.load(std::memory_order_acquire));
+    }
+
+    // builds and publishes a snapshot with the batch applied. readers see
+    // either none or all of its changes.
+    void publish(const Batch& batch) {
+      if (batch.is_empty()) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(writer);
+      const Snapshot* old = current.load(std::memory_order_relaxed);
+      Snapshot* next = new Snapshot(capacity_for(old->table.len() + batch.inserts));
+      for (auto& slot : old->table) {
+        if (!batch.changes.contains_key(slot.key)) {
+          next->table.insert(slot.key, slot.value);
+        }
+      }
+      batch.changes.for_each([&](const K& key, const std::optional<V>& value) {
+        if (value.has_value()) {
+          next->table.insert(key, value.value());
+        }
+        });
+      current.store(next, std::memory_order_release);
+      epoch::retire(const_cast<Snapshot*>(old), Snapshot::destroy_retired);
+      // a snapshot is a whole table: free it as soon as the readers allow
+      // rather than once 64 of them have piled up on this thread
+      epoch::collect();
+    }
+
+    // calls f(Batch&) and publishes what it recorded
+    template <typename F>
+    void update(F f) {
+      Batch batch;
+      f(batch);
+      publish(batch);
+    }
+
+    void insert(const K& key, const V& value) {
+      update([&](Batch& batch) {
+        batch.insert(key, value);
+        });
+    }
+
+    void remove(const K& key) {
+      update([&](Batch& batch) {
+        batch.remove(key);
+        });
+    }
+  };
+}
+
+#endif // DSUN_SNAPSHOT_MAP_H
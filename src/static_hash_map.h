@@ -0,0 +1,501 @@
+#ifndef DSUN_STATIC_HASH_MAP_H
+#define DSUN_STATIC_HASH_MAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hash.h"
+#include "hasher.h"
+#include "table_file.h"
+
+namespace dsun {
+
+  // immutable map over a fixed key set, built once with a perfect hash in
+  // the style of PTHash, so no slot is probed and none is wasted on load
+  // factor headroom.
+  //
+  // keys are split into buckets, a few keys each. for every bucket the
+  // builder searches for a 16-bit "pilot" that sends all of the bucket's
+  // keys to slots no other key has taken; biggest buckets go first, while
+  // the table is still empty. a lookup then costs
+  //
+  //   hash the key, read its bucket's pilot      (memory access 1)
+  //   hash again with the pilot, read the slot   (memory access 2)
+  //
+  // plus a read of the partition table, a few KB that stays in cache.
+  // there are 3/16 as many buckets as keys, so the pilots take 3 bits per
+  // key. the table has 1% more slots than keys: filling the very last free
+  // slots would cost most of the build time.
+  //
+  // keys are not stored. each slot keeps the 64-bit hash of its key as a
+  // fingerprint, and a key whose hash differs is reported absent; an absent
+  // key is accepted only if its full hash equals that of the key in the
+  // slot it lands on. two distinct keys with the same 64-bit hash cannot be
+  // told apart at all, and make build() fail.
+  //
+  // the keys are split into partitions of about 1M keys, each with its own
+  // pilots and slot range, which are built in parallel.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>>
+  class StaticHashMap {
+  private:
+    struct Slot {
+      uint64_t fingerprint;
+      V value;
+    };
+
+    struct Partition {
+      uint64_t bucket_offset;
+      uint64_t slot_offset;
+      uint64_t seed;
+      uint32_t buckets;
+      uint32_t slots;
+    };
+
+    static constexpr size_t kPartitionKeys = size_t(1) << 20;
+    static constexpr int kSeedAttempts = 16;
+    // 1: partitions and pilots in the ctrl section, slots in the records
+    // 2: the header records the hasher
+    static constexpr uint32_t kFileVersion = 2;
+
+    const Partition* partitions_ = nullptr;
+    const uint16_t* pilots_ = nullptr;
+    const Slot* slots_ = nullptr;
+    size_t partition_count_ = 0;
+    size_t pilot_count_ = 0;
+    size_t slot_count_ = 0;
+    size_t len_ = 0;
+    std::vector<Partition> owned_partitions;
+    std::vector<uint16_t> owned_pilots;
+    std::vector<Slot> owned_slots;
+    // set when the arrays live in a mapped file rather than on the heap
+    std::unique_ptr<table_file::Mapping> mapping_;
+
+    StaticHashMap() = default;
+
+    // the high 64 bits of x * n: maps x uniformly onto [0, n) without a division
+    static uint64_t reduce(uint64_t x, uint64_t n) {
+      uint64_t high = n;
+      hashing::multiply(x, high);
+      return high;
+    }
+
+    // skewed bucket choice: 60% of the keys share the first 30% of the
+    // buckets, which makes a few big buckets to place while the table is
+    // empty and many small ones that fit into the gaps later
+    static uint64_t bucket_of(uint64_t hash, uint64_t buckets) {
+      uint64_t x = hash * 0x9E3779B97F4A7C15ull;
+      uint64_t dense = std::max<uint64_t>(1, buckets * 3 / 10);
+      if (dense == buckets || (x & 0xFFFFFFFF) < 0x99999999ull) {
+        return reduce(x, dense);
+      }
+      return dense + reduce(x, buckets - dense);
+    }
+
+    static uint64_t position(uint64_t hash, uint64_t seed, uint16_t pilot, uint64_t slots) {
+      return reduce(mix(hash ^ seed ^ (pilot * 0xC2B2AE3D27D4EB4Full)), slots);
+    }
+
+    static uint64_t hash_key(const K& key) {
+      return static_cast<uint64_t>(Hash{}(key));
+    }
+
+    void adopt_owned() {
+      partitions_ = owned_partitions.data();
+      pilots_ = owned_pilots.data();
+      slots_ = owned_slots.data();
+      partition_count_ = owned_partitions.size();
+      pilot_count_ = owned_pilots.size();
+      slot_count_ = owned_slots.size();
+    }
+
+    // a key of one partition, hashed, with where it came from
+    struct Pending {
+      uint64_t hash;
+      size_t item;
+    };
+
+    // sorts and dedups one partition's keys in place. false if two distinct
+    // keys share a hash.
+    static bool dedup(std::span<const std::pair<K, V>> items, std::vector<Pending>& keys) {
+      std::sort(keys.begin(), keys.end(), [](const Pending& a, const Pending& b) {
+        return a.hash < b.hash || (a.hash == b.hash && a.item < b.item);
+        });
+      size_t out = 0;
+      for (size_t i = 0; i < keys.size(); i++) {
+        if (out > 0 && keys[out - 1].hash == keys[i].hash) {
+          if (!(items[keys[out - 1].item].first == items[keys[i].item].first)) {
+            return false;
+          }
+          // the later item wins
+          keys[out - 1] = keys[i];
+        }
+        else {
+          keys[out++] = keys[i];
+        }
+      }
+      keys.resize(out);
+      return true;
+    }
+
+    // finds a pilot for every bucket of the partition. false if some bucket
+    // has none in 16 bits, the caller then retries with another seed.
+    static bool place(const std::vector<Pending>& keys, const Partition& partition, uint16_t* pilots, std::vector<uint32_t>& slot_of) {
+      size_t buckets = partition.buckets;
+      // counting sort of the keys by bucket
+      std::vector<uint32_t> bucket_start(buckets + 1);
+      std::vector<uint32_t> bucket(keys.size());
+      for (size_t i = 0; i < keys.size(); i++) {
+        bucket[i] = static_cast<uint32_t>(bucket_of(keys[i].hash, buckets));
+        bucket_start[bucket[i] + 1]++;
+      }
+      size_t largest = 0;
+      for (size_t b = 0; b < buckets; b++) {
+        largest = std::max<size_t>(largest, bucket_start[b + 1]);
+        bucket_start[b + 1] += bucket_start[b];
+      }
+      std::vector<uint32_t> members(keys.size());
+      {
+        std::vector<uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+        for (size_t i = 0; i < keys.size(); i++) {
+          members[next[bucket[i]]++] = static_cast<uint32_t>(i);
+        }
+      }
+      // buckets by decreasing size
+      std::vector<uint32_t> by_size(buckets);
+      {
+        std::vector<uint32_t> size_start(largest + 2);
+        for (size_t b = 0; b < buckets; b++) {
+          size_start[largest - (bucket_start[b + 1] - bucket_start[b]) + 1]++;
+        }
+        for (size_t s = 0; s <= largest; s++) {
+          size_start[s + 1] += size_start[s];
+        }
+        for (size_t b = 0; b < buckets; b++) {
+          by_size[size_start[largest - (bucket_start[b + 1] - bucket_start[b])]++] = static_cast<uint32_t>(b);
+        }
+      }
+
+      std::vector<bool> taken(partition.slots);
+      std::vector<uint32_t> tried(largest);
+      for (uint32_t b : by_size) {
+        uint32_t first = bucket_start[b];
+        uint32_t count = bucket_start[b + 1] - first;
+        pilots[b] = 0;
+        if (count == 0) {
+          continue;
+        }
+        bool placed = false;
+        for (uint32_t pilot = 0; pilot <= UINT16_MAX && !placed; pilot++) {
+          uint32_t marked = 0;
+          while (marked < count) {
+            uint64_t slot = position(keys[members[first + marked]].hash, partition.seed, static_cast<uint16_t>(pilot), partition.slots);
+            if (taken[slot]) {
+              break;
+            }
+            taken[slot] = true;
+            tried[marked++] = static_cast<uint32_t>(slot);
+          }
+          if (marked == count) {
+            placed = true;
+            pilots[b] = static_cast<uint16_t>(pilot);
+            for (uint32_t i = 0; i < count; i++) {
+              slot_of[members[first + i]] = tried[i];
+            }
+          }
+          else {
+            for (uint32_t i = 0; i < marked; i++) {
+              taken[tried[i]] = false;
+            }
+          }
+        }
+        if (!placed) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    static table_file::Header file_header() {
+      auto header = table_file::make_header("DSUNSTAT", kFileVersion, sizeof(K), sizeof(V), sizeof(Slot));
+      header.hasher_id = table_file::hasher_id<K>(Hash{});
+      return header;
+    }
+
+    // the ctrl section holds the partition count, the partition table and,
+    // from the next aligned offset, the pilots
+    static uint64_t pilots_offset(const table_file::Header& header, uint64_t partition_count) {
+      return table_file::align_up(header.ctrl_offset + sizeof(uint64_t) + partition_count * sizeof(Partition));
+    }
+
+  public:
+    StaticHashMap(const StaticHashMap&) = delete;
+    StaticHashMap& operator=(const StaticHashMap&) = delete;
+    // the moved-from map is left empty. the views keep pointing at the
+    // same storage, which swapping the vectors and the mapping does not move.
+    StaticHashMap(StaticHashMap&& other) noexcept {
+      swap(other);
+    }
+
+    StaticHashMap& operator=(StaticHashMap&& other) noexcept {
+      StaticHashMap moved(std::move(other));
+      swap(moved);
+      return *this;
+    }
+
+    void swap(StaticHashMap& other) noexcept {
+      std::swap(partitions_, other.partitions_);
+      std::swap(pilots_, other.pilots_);
+      std::swap(slots_, other.slots_);
+      std::swap(partition_count_, other.partition_count_);
+      std::swap(pilot_count_, other.pilot_count_);
+      std::swap(slot_count_, other.slot_count_);
+      std::swap(len_, other.len_);
+      owned_partitions.swap(other.owned_partitions);
+      owned_pilots.swap(other.owned_pilots);
+      owned_slots.swap(other.owned_slots);
+      mapping_.swap(other.mapping_);
+    }
+
+    // builds the map on `threads` threads (0: one per core). a key given
+    // more than once keeps its last value. nullopt if two distinct keys
+    // have the same 64-bit hash, or, with vanishing probability, if no
+    // seed yields pilots for some partition.
+    static std::optional<StaticHashMap> build(std::span<const std::pair<K, V>> items, size_t threads = 0)
+      requires std::default_initializable<V> {
+      if (threads == 0) {
+        threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+      }
+      size_t partition_count = std::max<size_t>(1, (items.size() + kPartitionKeys - 1) / kPartitionKeys);
+      auto run_parallel = [threads](size_t tasks, auto f) {
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < std::min(threads, tasks); t++) {
+          workers.emplace_back([&, t]() {
+            for (size_t task = t; task < tasks; task += threads) {
+              f(task);
+            }
+            });
+        }
+        for (size_t task = 0; task < tasks; task += threads) {
+          f(task);
+        }
+        for (auto& worker : workers) {
+          worker.join();
+        }
+      };
+
+      // hash and split by partition
+      std::vector<std::vector<Pending>> partition_keys(partition_count);
+      {
+        size_t chunks = std::min(threads, std::max<size_t>(1, items.size() / 4096));
+        std::vector<std::vector<std::vector<Pending>>> per_chunk(chunks, std::vector<std::vector<Pending>>(partition_count));
+        run_parallel(chunks, [&](size_t c) {
+          for (size_t i = items.size() * c / chunks; i < items.size() * (c + 1) / chunks; i++) {
+            uint64_t hash = hash_key(items[i].first);
+            per_chunk[c][reduce(hash, partition_count)].push_back({ hash, i });
+          }
+          });
+        run_parallel(partition_count, [&](size_t p) {
+          for (auto& chunk : per_chunk) {
+            partition_keys[p].insert(partition_keys[p].end(), chunk[p].begin(), chunk[p].end());
+            std::vector<Pending>().swap(chunk[p]);
+          }
+          });
+      }
+
+      std::atomic<bool> unique = true;
+      run_parallel(partition_count, [&](size_t p) {
+        if (!dedup(items, partition_keys[p])) {
+          unique = false;
+        }
+        });
+      if (!unique) {
+        return std::nullopt;
+      }
+
+      // sizes and offsets are fixed before any partition is built, so the
+      // threads write disjoint ranges of the pilot and slot arrays
+      StaticHashMap map;
+      map.owned_partitions.resize(partition_count);
+      uint64_t bucket_offset = 0;
+      uint64_t slot_offset = 0;
+      for (size_t p = 0; p < partition_count; p++) {
+        size_t n = partition_keys[p].size();
+        Partition& partition = map.owned_partitions[p];
+        partition.bucket_offset = bucket_offset;
+        partition.slot_offset = slot_offset;
+        partition.buckets = static_cast<uint32_t>(std::max<size_t>(1, (n * 3 + 15) / 16));
+        partition.slots = static_cast<uint32_t>(std::max<size_t>(1, (n * 100 + 98) / 99));
+        bucket_offset += partition.buckets;
+        slot_offset += partition.slots;
+        map.len_ += n;
+      }
+      map.owned_pilots.resize(bucket_offset);
+
+      // a free slot holds the hash of some key, which lands on that key's
+      // slot and so can never be mistaken for a key that lands on this one
+      uint64_t filler = 0;
+      for (auto& keys : partition_keys) {
+        if (!keys.empty()) {
+          filler = keys.front().hash;
+          break;
+        }
+      }
+      map.owned_slots.resize(slot_offset, Slot{ filler, V() });
+      std::atomic<bool> placed = true;
+      run_parallel(partition_count, [&](size_t p) {
+        Partition& partition = map.owned_partitions[p];
+        const std::vector<Pending>& keys = partition_keys[p];
+        std::vector<uint32_t> slot_of(keys.size());
+        for (int attempt = 0; attempt < kSeedAttempts; attempt++) {
+          partition.seed = mix(p * kSeedAttempts + attempt);
+          if (place(keys, partition, &map.owned_pilots[partition.bucket_offset], slot_of)) {
+            for (size_t i = 0; i < keys.size(); i++) {
+              map.owned_slots[partition.slot_offset + slot_of[i]] = Slot{ keys[i].hash, items[keys[i].item].second };
+            }
+            return;
+          }
+        }
+        placed = false;
+        });
+      if (!placed) {
+        return std::nullopt;
+      }
+      map.adopt_owned();
+      return map;
+    }
+
+    // pointer to the value for `key`, or nullptr
+    const V* find(const K& key) const {
+      if (len_ == 0) {
+        return nullptr;
+      }
+      uint64_t hash = hash_key(key);
+      const Partition& partition = partitions_[reduce(hash, partition_count_)];
+      uint16_t pilot = pilots_[partition.bucket_offset + bucket_of(hash, partition.buckets)];
+      const Slot& slot = slots_[partition.slot_offset + position(hash, partition.seed, pilot, partition.slots)];
+      return slot.fingerprint == hash ? &slot.value : nullptr;
+    }
+
+    bool contains_key(const K& key) const {
+      return find(key) != nullptr;
+    }
+
+    [[nodiscard]] size_t len() const {
+      return len_;
+    }
+
+    // bits of pilots and partition table per key, slots not counted
+    [[nodiscard]] double metadata_bits_per_key() const {
+      if (len_ == 0) {
+        return 0;
+      }
+      return static_cast<double>(pilot_count_ * 16 + partition_count_ * sizeof(Partition) * 8) / static_cast<double>(len_);
+    }
+
+    // writes the partition table, pilots and slots as they are in memory.
+    // returns false on an i/o error.
+    bool save(const char* path) const
+      requires std::is_trivially_copyable_v<Slot> {
+      table_file::Header header = file_header();
+      header.capacity = slot_count_;
+      header.len = len_;
+      header.ctrl_offset = table_file::align_up(sizeof(header));
+      uint64_t pilots_at = pilots_offset(header, partition_count_);
+      header.records_offset = table_file::align_up(pilots_at + pilot_count_ * sizeof(uint16_t));
+      header.file_size = header.records_offset + slot_count_ * sizeof(Slot);
+      table_file::Writer writer(path);
+      writer.write(&header, sizeof(header));
+      writer.pad_to(header.ctrl_offset);
+      uint64_t partition_count = partition_count_;
+      writer.write(&partition_count, sizeof(partition_count));
+      writer.write(partitions_, partition_count_ * sizeof(Partition));
+      writer.pad_to(pilots_at);
+      writer.write(pilots_, pilot_count_ * sizeof(uint16_t));
+      writer.pad_to(header.records_offset);
+      writer.write(slots_, slot_count_ * sizeof(Slot));
+      return writer.finish();
+    }
+
+    // a map that reads straight from the file saved by save(), nothing is
+    // copied; nullopt if the file is missing, truncated, inconsistent or
+    // was written for other key / value types or another hasher
+    static std::optional<StaticHashMap> open_mapped(const char* path)
+      requires std::is_trivially_copyable_v<Slot> {
+      auto file = table_file::Mapping::open(path);
+      if (!file.has_value()) {
+        return std::nullopt;
+      }
+      auto header = table_file::read_header(file->data(), file->size(), file_header());
+      if (!header.has_value() || !table_file::fits(*header, header->ctrl_offset, sizeof(uint64_t))
+        || header->capacity > header->file_size / sizeof(Slot)
+        || !table_file::fits(*header, header->records_offset, header->capacity * sizeof(Slot))) {
+        return std::nullopt;
+      }
+      uint64_t partition_count;
+      std::memcpy(&partition_count, file->data() + header->ctrl_offset, sizeof(partition_count));
+      if (partition_count == 0 || partition_count > header->file_size / sizeof(Partition)
+        || !table_file::fits(*header, header->ctrl_offset + sizeof(uint64_t), partition_count * sizeof(Partition))) {
+        return std::nullopt;
+      }
+      uint64_t pilots_at = pilots_offset(*header, partition_count);
+      auto* partitions = reinterpret_cast<const Partition*>(file->data() + header->ctrl_offset + sizeof(uint64_t));
+      // every partition's pilots and slots must lie inside the sections
+      uint64_t pilot_count = 0;
+      for (size_t p = 0; p < partition_count; p++) {
+        const Partition& partition = partitions[p];
+        if (partition.bucket_offset != pilot_count || partition.buckets == 0 || partition.slots == 0
+          || partition.slot_offset > header->capacity || partition.slots > header->capacity - partition.slot_offset) {
+          return std::nullopt;
+        }
+        pilot_count += partition.buckets;
+      }
+      if (!table_file::fits(*header, pilots_at, pilot_count * sizeof(uint16_t))
+        || pilots_at + pilot_count * sizeof(uint16_t) > header->records_offset) {
+        return std::nullopt;
+      }
+      StaticHashMap map;
+      map.mapping_ = std::make_unique<table_file::Mapping>(std::move(file.value()));
+      const unsigned char* data = map.mapping_->data();
+      map.partitions_ = reinterpret_cast<const Partition*>(data + header->ctrl_offset + sizeof(uint64_t));
+      map.pilots_ = reinterpret_cast<const uint16_t*>(data + pilots_at);
+      map.slots_ = reinterpret_cast<const Slot*>(data + header->records_offset);
+      map.partition_count_ = partition_count;
+      map.pilot_count_ = pilot_count;
+      map.slot_count_ = header->capacity;
+      map.len_ = header->len;
+      return map;
+    }
+
+    // a heap copy of a map saved by save()
+    static std::optional<StaticHashMap> load(const char* path)
+      requires std::is_trivially_copyable_v<Slot> {
+      auto mapped = open_mapped(path);
+      if (!mapped.has_value()) {
+        return std::nullopt;
+      }
+      StaticHashMap map;
+      map.owned_partitions.assign(mapped->partitions_, mapped->partitions_ + mapped->partition_count_);
+      map.owned_pilots.assign(mapped->pilots_, mapped->pilots_ + mapped->pilot_count_);
+      map.owned_slots.assign(mapped->slots_, mapped->slots_ + mapped->slot_count_);
+      map.len_ = mapped->len_;
+      map.adopt_owned();
+      return map;
+    }
+
+    [[nodiscard]] bool is_mapped() const {
+      return mapping_ != nullptr;
+    }
+  };
+}
+
+#endif // DSUN_STATIC_HASH_MAP_H
@@ -1,28 +1,63 @@
 #ifndef DSUN_SWISSTABLE_H
 #define DSUN_SWISSTABLE_H
 
+#include <algorithm>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <bit>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSUN_SWISS_X86 1
 #ifdef _MSC_VER
 #include <intrin.h>
-#endif
-#ifndef _MSC_VER
+#else
 #include <immintrin.h>
 #endif
-#include <bit>
+#else
+#define DSUN_SWISS_X86 0
+#endif
+
+// compiles one function for an instruction set the rest of the program
+// may not be built with. msvc needs nothing for intrinsics.
+#if defined(__GNUC__) || defined(__clang__)
+#define DSUN_SWISS_TARGET(isa) __attribute__((target(isa)))
+#define DSUN_SWISS_KERNEL(isa) __attribute__((target(isa), flatten))
+#else
+#define DSUN_SWISS_TARGET(isa)
+#define DSUN_SWISS_KERNEL(isa)
+#endif
+#include "hash.h"
+#include "hash_stats.h"
+#include "table_file.h"
 
 namespace SwissTables {
 
-  template <typename T>
-  concept Hashable = requires(T a) {
+  // a default-constructible function object from keys to size_t hashes
+  template <typename H, typename K>
+  concept KeyHasher = std::default_initializable<H> && requires(const H & hasher, const K & key) {
     {
-      std::hash<T>{}(a)
+      hasher(key)
     } -> std::convertible_to<std::size_t>;
   };
+
+  // a hasher that already spreads its entropy over all 64 bits says so
+  // with an is_avalanching member type, like dsun::Hash does
+  template <typename H>
+  concept Avalanching = requires {
+    typename H::is_avalanching;
+  };
   namespace {
     // ctrl_t is a 8-bit type
     // this is needed to be added SIMD instructions in the future
@@ -31,14 +66,16 @@ namespace SwissTables {
     enum class ctrl_t : int8_t {
       Empty = -128, // 0b10000000
       Deleted = -2, // 0b11111110
+      // after the last ctrl byte, where iteration stops. never inside a
+      // group: groups are aligned and end at the capacity.
+      Sentinel = -1, // 0b11111111
       // Full = 0b0xxxxxxx
     };
 
-    inline size_t PerTableSalt(const ctrl_t* ctrl) {
-      return reinterpret_cast<uintptr_t>(ctrl) >> 12;
-    }
-    inline size_t H1(size_t hash, const ctrl_t* ctrl) {
-      return (hash >> 7) ^ PerTableSalt(ctrl);
+    // no per-table salt from the ctrl address: a table saved to disk and
+    // mapped back at another address has to probe the same slots
+    inline size_t H1(size_t hash) {
+      return hash >> 7;
     }
 
     inline uint8_t H2(size_t hash) {
@@ -53,40 +90,43 @@ namespace SwissTables {
     inline bool IsDeleted(ctrl_t c) {
       return c == ctrl_t::Deleted;
     }
+    inline bool IsEmptyOrDeleted(ctrl_t c) {
+      return c < ctrl_t::Sentinel;
+    }
     template <typename T>
     uint32_t TrailingZeros(T x) {
       return static_cast<uint32_t>(std::countr_zero(x));
     }
 
-    // in future should be implemented as a hash that can
-    // distribute the entropy uniformly
-    // if the entropy is distributed in the last 7 bits at most
-    // the ctrl bytes will have more collisions
-    // if the entropy is distributed in the first 57 bits at most
-    // the table will have more collisions
     // [1,2,3,4,5...57 bits][1,2,3...7 bits]
     //      raw table           metadata
-    template <Hashable K>
-    size_t swiss_hash(const K& key) {
-      size_t hash = 5381;
-      auto k = key;
-      while ((int)k != 0) {
-        int remainder = key % 10;
-        hash = ((hash << 5) + hash) + remainder; // hash * 33 + remainder
-        k = k / 10;
+    //
+    // both halves need entropy. a hasher that is not avalanching (say the
+    // identity std::hash<int>) is mixed once more, or H2 would be the low
+    // bits of the key and H1 nearly constant for small keys.
+    template <typename Hash, typename K>
+    size_t swiss_hash(const Hash& hasher, const K& key) {
+      if constexpr (Avalanching<Hash>) {
+        return static_cast<size_t>(hasher(key));
+      }
+      else {
+        return static_cast<size_t>(dsun::mix(static_cast<uint64_t>(hasher(key))));
       }
-      return hash;
     }
+    // the slots of a group selected by a match, one bit per slot (or, with
+    // Shift 3, the top bit of one byte per slot); iterating yields the
+    // slot indexes in increasing order
+    template <typename T, int Shift = 0>
     struct BitMask {
-      uint16_t mask_;
+      T mask_;
       BitMask() = default;
-      BitMask(uint16_t mask) : mask_(mask) {}
+      BitMask(T mask) : mask_(mask) {}
 
       uint32_t trailing_zeros() const {
-        return TrailingZeros(mask_);
+        return TrailingZeros(mask_) >> Shift;
       }
       uint32_t highest_bit_set() const {
-        return static_cast<uint32_t>(std::bit_width(mask_) - 1);
+        return static_cast<uint32_t>(std::bit_width(mask_) - 1) >> Shift;
       }
       uint32_t lowest_bit_set() const {
         return trailing_zeros();
@@ -119,112 +159,1261 @@ namespace SwissTables {
     };
 
     // abstraction over a group of control bytes which can be scanned in
-    // parallel.
+    // parallel. every group type has
+    //
+    //   kWidth                  slots per group, a power of two
+    //   load(ctrl)              the kWidth ctrl bytes starting at ctrl
+    //   match_byte(h2)          slots whose byte may be h2 (false positives
+    //                           are allowed, the key compare sorts them out)
+    //   match_empty()           exactly the empty slots
+    //   match_empty_or_deleted  exactly the empty and deleted slots
+    //   supported()             whether the running cpu can execute it
+    //
+    // GroupSse2 (16) is the default on x86. GroupAvx2 (32) and GroupAvx512
+    // (64) are compiled for their instruction set with a target attribute,
+    // so they need no -mavx2 / -mavx512bw, but they are inlined only into
+    // callers compiled for it too (see DSUN_SWISS_KERNEL). GroupPortable
+    // (8) is plain 64-bit arithmetic and works anywhere.
     //
-    // this implementation uses a 128-bit SSE value.
-    struct Group {
+    // DSUN_SWISS_GROUP_WIDTH (8, 16, 32 or 64) picks the default at
+    // compile time. a table saved with one width cannot be read with another.
+
+    // 8 ctrl bytes in a uint64_t, matched with SWAR bit tricks; byte i of
+    // the group is bits 8i..8i+7 whatever the machine's byte order
+    struct GroupPortable {
+      static constexpr size_t kWidth = 8;
+      static constexpr uint64_t kLsbs = 0x0101010101010101ull;
+      static constexpr uint64_t kMsbs = 0x8080808080808080ull;
+      using Mask = BitMask<uint64_t, 3>;
+      uint64_t ctrl;
+
+      // a byte equal to h2 ends up zero in x, and x - lsbs borrows into its
+      // top bit. the borrow can also flag the byte after a real match.
+      Mask match_byte(int8_t byte) const {
+        uint64_t x = ctrl ^ (kLsbs * static_cast<uint8_t>(byte));
+        return Mask((x - kLsbs) & ~x & kMsbs);
+      }
+      // empty is the only byte with the top bit set and bit 1 clear
+      Mask match_empty() const {
+        return Mask(ctrl & ~(ctrl << 6) & kMsbs);
+      }
+      Mask match_empty_or_deleted() const {
+        return Mask(ctrl & kMsbs);
+      }
+      static GroupPortable load(const ctrl_t* ptr) {
+        uint64_t ctrl = 0;
+        for (size_t i = 0; i < kWidth; i++) {
+          ctrl |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[i])) << (8 * i);
+        }
+        return GroupPortable{ ctrl };
+      }
+      static bool supported() {
+        return true;
+      }
+    };
+
+#if DSUN_SWISS_X86
+    // 16 ctrl bytes in a 128-bit SSE2 register
+    struct GroupSse2 {
+      static constexpr size_t kWidth = 16;
+      using Mask = BitMask<uint16_t>;
       __m128i data;
 
-      BitMask match_byte(int8_t byte) {
+      Mask match_byte(int8_t byte) const {
         auto match = _mm_set1_epi8(static_cast<char>(byte));
-        return BitMask{ static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, data))) };
+        return Mask{ static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, data))) };
       }
-      BitMask match_empty() {
+      Mask match_empty() const {
         auto match = _mm_set1_epi8(static_cast<char>(ctrl_t::Empty));
-        return BitMask{ static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, data))) };
+        return Mask{ static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, data))) };
       }
-      static Group load(const ctrl_t* ptr) {
-        return Group{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)) };
+      // empty and deleted are the only ctrl bytes with the sign bit set
+      Mask match_empty_or_deleted() const {
+        return Mask{ static_cast<uint16_t>(_mm_movemask_epi8(data)) };
+      }
+      static GroupSse2 load(const ctrl_t* ptr) {
+        return GroupSse2{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)) };
+      }
+      static bool supported() {
+        return true;
       }
     };
 
+    // the wide groups keep a pointer rather than a register: passing a
+    // 256 or 512-bit vector by value between functions compiled for
+    // different instruction sets changes the calling convention. once
+    // inlined the repeated loads are merged.
+
+    // 32 ctrl bytes in a 256-bit AVX2 register
+    struct GroupAvx2 {
+      static constexpr size_t kWidth = 32;
+      using Mask = BitMask<uint32_t>;
+      const ctrl_t* ctrl;
+
+      DSUN_SWISS_TARGET("avx2") Mask match_byte(int8_t byte) const {
+        auto match = _mm256_set1_epi8(static_cast<char>(byte));
+        return Mask{ static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(match, vector()))) };
+      }
+      DSUN_SWISS_TARGET("avx2") Mask match_empty() const {
+        auto match = _mm256_set1_epi8(static_cast<char>(ctrl_t::Empty));
+        return Mask{ static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(match, vector()))) };
+      }
+      DSUN_SWISS_TARGET("avx2") Mask match_empty_or_deleted() const {
+        return Mask{ static_cast<uint32_t>(_mm256_movemask_epi8(vector())) };
+      }
+      DSUN_SWISS_TARGET("avx2") __m256i vector() const {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ctrl));
+      }
+      static GroupAvx2 load(const ctrl_t* ptr) {
+        return GroupAvx2{ ptr };
+      }
+      static bool supported() {
+#if defined(__AVX2__)
+        return true;
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+      }
+    };
+
+    // 64 ctrl bytes, a whole cache line, in a 512-bit AVX-512BW register
+    struct GroupAvx512 {
+      static constexpr size_t kWidth = 64;
+      using Mask = BitMask<uint64_t>;
+      const ctrl_t* ctrl;
+
+      DSUN_SWISS_TARGET("avx512bw") Mask match_byte(int8_t byte) const {
+        return Mask{ _mm512_cmpeq_epi8_mask(_mm512_set1_epi8(static_cast<char>(byte)), vector()) };
+      }
+      DSUN_SWISS_TARGET("avx512bw") Mask match_empty() const {
+        return Mask{ _mm512_cmpeq_epi8_mask(_mm512_set1_epi8(static_cast<char>(ctrl_t::Empty)), vector()) };
+      }
+      DSUN_SWISS_TARGET("avx512bw") Mask match_empty_or_deleted() const {
+        return Mask{ _mm512_movepi8_mask(vector()) };
+      }
+      DSUN_SWISS_TARGET("avx512bw") __m512i vector() const {
+        return _mm512_loadu_si512(ctrl);
+      }
+      static GroupAvx512 load(const ctrl_t* ptr) {
+        return GroupAvx512{ ptr };
+      }
+      static bool supported() {
+#if defined(__AVX512BW__)
+        return true;
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("avx512bw");
+#else
+        return false;
+#endif
+      }
+    };
+#endif
+
+#if !defined(DSUN_SWISS_GROUP_WIDTH)
+#if DSUN_SWISS_X86
+#define DSUN_SWISS_GROUP_WIDTH 16
+#else
+#define DSUN_SWISS_GROUP_WIDTH 8
+#endif
+#endif
+
+#if DSUN_SWISS_GROUP_WIDTH == 8
+    using DefaultGroup = GroupPortable;
+#elif DSUN_SWISS_X86 && DSUN_SWISS_GROUP_WIDTH == 16
+    using DefaultGroup = GroupSse2;
+#elif DSUN_SWISS_X86 && DSUN_SWISS_GROUP_WIDTH == 32
+    using DefaultGroup = GroupAvx2;
+#elif DSUN_SWISS_X86 && DSUN_SWISS_GROUP_WIDTH == 64
+    using DefaultGroup = GroupAvx512;
+#else
+#error "DSUN_SWISS_GROUP_WIDTH must be 8, or 16, 32 or 64 on x86"
+#endif
+
   }
-  template <Hashable K, typename V>
-  class FlatHashMap {
-  private:
-    struct slots_t {
+
+  template <typename G>
+  concept GroupType = requires(const ctrl_t * ctrl, const G & group, int8_t byte) {
+    {
+      G::kWidth
+    } -> std::convertible_to<size_t>;
+    {
+      G::load(ctrl)
+    } -> std::same_as<G>;
+    group.match_byte(byte);
+    group.match_empty();
+    group.match_empty_or_deleted();
+    {
+      G::supported()
+    } -> std::convertible_to<bool>;
+  };
+
+  // runtime dispatch: calls f(std::type_identity<G>{}) with the widest group
+  // the running cpu supports and returns what it returns. for the wide
+  // groups to be inlined, f has to pass the group type on to a function
+  // declared DSUN_SWISS_KERNEL("avx2") / ("avx512bw"), or to code built
+  // with that instruction set enabled.
+  template <typename F>
+  decltype(auto) with_widest_group(F&& f) {
+#if DSUN_SWISS_X86
+    if (GroupAvx512::supported()) {
+      return f(std::type_identity<GroupAvx512>{});
+    }
+    if (GroupAvx2::supported()) {
+      return f(std::type_identity<GroupAvx2>{});
+    }
+    return f(std::type_identity<GroupSse2>{});
+#else
+    return f(std::type_identity<GroupPortable>{});
+#endif
+  }
+
+  // what a slot holds in each of the tables below, and how to get the key
+  // (and value) out of it
+  template <typename K, typename V>
+  struct MapPolicy {
+    using key_type = K;
+    using mapped_type = V;
+    struct slot_type {
+      K key;
+      V value;
+    };
+    using reference = slot_type&;
+    static const K& key(const slot_type& slot) {
+      return slot.key;
+    }
+    static V& value(slot_type& slot) {
+      return slot.value;
+    }
+    static reference element(slot_type& slot) {
+      return slot;
+    }
+    // slots are raw storage until an element is constructed in them
+    template <typename KeyArg>
+    static void construct(slot_type* slot, KeyArg&& key, V value) {
+      new (slot) slot_type{ std::forward<KeyArg>(key), std::move(value) };
+    }
+    static void destroy(slot_type* slot) {
+      std::destroy_at(slot);
+    }
+    static constexpr bool kTrivialDestroy = std::is_trivially_destructible_v<slot_type>;
+    // heap memory per element outside the slot array
+    static constexpr size_t kNodeBytes = 0;
+  };
+
+  template <typename K>
+  struct SetPolicy {
+    using key_type = K;
+    using slot_type = K;
+    using reference = const K&;
+    static const K& key(const slot_type& slot) {
+      return slot;
+    }
+    static reference element(slot_type& slot) {
+      return slot;
+    }
+    static void construct(slot_type* slot, const K& key) {
+      std::construct_at(slot, key);
+    }
+    static void destroy(slot_type* slot) {
+      std::destroy_at(slot);
+    }
+    static constexpr bool kTrivialDestroy = std::is_trivially_destructible_v<slot_type>;
+    // heap memory per element outside the slot array
+    static constexpr size_t kNodeBytes = 0;
+  };
+
+  // slots hold a pointer to a heap node, which a rehash never moves
+  template <typename K, typename V>
+  struct NodePolicy {
+    using key_type = K;
+    using mapped_type = V;
+    struct Node {
       K key;
       V value;
     };
+    using slot_type = Node*;
+    using reference = Node&;
+    static const K& key(const slot_type& slot) {
+      return slot->key;
+    }
+    static V& value(slot_type& slot) {
+      return slot->value;
+    }
+    static reference element(slot_type& slot) {
+      return *slot;
+    }
+    template <typename KeyArg>
+    static void construct(slot_type* slot, KeyArg&& key, V value) {
+      *slot = new Node{ std::forward<KeyArg>(key), std::move(value) };
+    }
+    static void destroy(slot_type* slot) {
+      delete *slot;
+    }
+    static constexpr bool kTrivialDestroy = false;
+    static constexpr size_t kNodeBytes = sizeof(Node);
+  };
+
+  // the open addressing core shared by FlatHashMap, FlatNodeHashMap and
+  // FlatHashSet: ctrl bytes, slots, probing, growth and erase. `Policy`
+  // says what a slot holds.
+  //
+  // a table is one allocation, aligned to a group (and to the slots):
+  //
+  //   [capacity ctrl bytes][sentinel][padding][capacity slots]
+  //
+  // slots are left uninitialized and an element is constructed in one on
+  // insert and destroyed on erase, so K and V need no default constructor.
+  // the sentinel ends iteration without a bounds check. probing needs no
+  // cloned ctrl bytes past it: groups are aligned, the last one ends at
+  // the capacity, and the probe wraps by masking the group index.
+  //
+  // the capacity is a power of two, split into groups of kGroupWidth slots.
+  // H1 of the hash picks the first group, and every ctrl byte of the group
+  // is compared against H2 in a single SIMD compare; only the slots whose
+  // byte matches have their key compared. a group with an empty slot ends
+  // the probe. otherwise the next group is reached by triangular steps
+  // (1, 2, 3, ... groups), which visit every group of the table once.
+  // `Group` sets how many ctrl bytes one compare covers, see GroupSse2.
+  //
+  // keys are hashed by `Hash`, dsun::Hash<K> by default, which covers
+  // integers, std::string / std::string_view and structs given a std::hash
+  // with DERIVE_HASH.
+  template <typename Policy, typename Hash, typename Group>
+    requires KeyHasher<Hash, typename Policy::key_type> && GroupType<Group>
+  class RawTable {
+    template <typename, typename, typename> friend class MapTable;
+    template <typename K, typename V, typename H, typename G>
+      requires KeyHasher<H, K> && GroupType<G>
+    friend class FlatHashMap;
+    template <typename K, typename H, typename G>
+      requires KeyHasher<H, K> && GroupType<G>
+    friend class FlatHashSet;
+  private:
+    using K = typename Policy::key_type;
+    using slots_t = typename Policy::slot_type;
+    static constexpr size_t kGroupWidth = Group::kWidth;
+
     ctrl_t* ctrl_;
     slots_t* slots_;
     size_t capacity_;
     size_t len_ = 0;
-  public:
+    // how many more empty slots may be filled before the table rehashes.
+    // it starts at 7/8 of the capacity and does not come back when an
+    // insert reuses a tombstone, so tombstones count against the load too.
+    size_t growth_left_;
+    [[no_unique_address]] Hash hasher_;
+    // set when the arrays live in a mapped file rather than on the heap,
+    // which only a FlatHashMapView's table does
+    std::unique_ptr<dsun::table_file::Mapping> mapping_;
+    // stay with the table object, they are not moved or swapped
+    [[no_unique_address]] dsun::hash_stats::LookupCounters<> counters_;
+
+    RawTable(ctrl_t* ctrl, slots_t* slots, size_t capacity, size_t len, Hash hasher, std::unique_ptr<dsun::table_file::Mapping> mapping)
+      : ctrl_(ctrl), slots_(slots), capacity_(capacity), len_(len), growth_left_(0), hasher_(std::move(hasher)), mapping_(std::move(mapping)) {}
 
-    FlatHashMap(size_t capacity = 16) : capacity_(capacity) {
-      ctrl_ = new ctrl_t[capacity_];
-      slots_ = new slots_t[capacity_];
-      std::fill(ctrl_, ctrl_ + capacity_, ctrl_t::Empty);
+    static constexpr size_t kAlignment = std::max(alignof(slots_t), kGroupWidth);
+
+    static size_t slots_offset(size_t capacity) {
+      return (capacity + 1 + alignof(slots_t) - 1) / alignof(slots_t) * alignof(slots_t);
     }
 
-    ~FlatHashMap() {
-      delete[] ctrl_;
-      delete[] slots_;
+    // points ctrl_ and slots_ at a new allocation with every slot empty
+    void allocate(size_t capacity) {
+      auto* memory = static_cast<unsigned char*>(
+        ::operator new(slots_offset(capacity) + capacity * sizeof(slots_t), std::align_val_t(kAlignment)));
+      ctrl_ = reinterpret_cast<ctrl_t*>(memory);
+      slots_ = reinterpret_cast<slots_t*>(memory + slots_offset(capacity));
+      capacity_ = capacity;
+      std::fill(ctrl_, ctrl_ + capacity, ctrl_t::Empty);
+      ctrl_[capacity] = ctrl_t::Sentinel;
     }
 
-    bool insert(const K& key, const V& value) {
-      size_t hash = swiss_hash(key);
-      size_t index = hash % capacity_;
-      size_t perturb = hash;
-      size_t i = 0;
-      while (!IsEmpty(ctrl_[index]) && !IsDeleted(ctrl_[index])) {
-        if (slots_[index].key == key) {
-          return false;
+    // destroys the elements and frees the allocation; a mapped table's
+    // arrays belong to the file
+    void release() {
+      if (ctrl_ == nullptr || mapping_ != nullptr) {
+        return;
+      }
+      if constexpr (!Policy::kTrivialDestroy) {
+        for (size_t i = 0; i < capacity_; i++) {
+          if (IsFull(ctrl_[i])) {
+            Policy::destroy(&slots_[i]);
+          }
         }
-        i++;
-        index = (index * 5 + 1 + i) % capacity_;
-        perturb >>= 5;
-        index = (index + perturb) % capacity_;
       }
-      slots_[index].key = key;
-      slots_[index].value = value;
-      ctrl_[index] = static_cast<ctrl_t>(hash >> 7);
+      ::operator delete(ctrl_, std::align_val_t(kAlignment));
+    }
+
+    // moves the element in `from` into the uninitialized slot `to`
+    static void transfer(slots_t* to, slots_t* from) {
+      std::construct_at(to, std::move(*from));
+      std::destroy_at(from);
+    }
+
+    static size_t growth_limit(size_t capacity) {
+      return capacity - capacity / 8;
+    }
+
+    // recounts the budget after the ctrl bytes were copied in from a file
+    void reset_growth_left() {
+      size_t used = 0;
+      for (size_t i = 0; i < capacity_; i++) {
+        used += !IsEmpty(ctrl_[i]);
+      }
+      growth_left_ = used < growth_limit(capacity_) ? growth_limit(capacity_) - used : 0;
+    }
+
+    size_t hash_key(const K& key) const {
+      return swiss_hash(hasher_, key);
+    }
+
+    // walks the probe sequence of `key` once. returns the slot holding the
+    // key, or else the first free slot on the way, where it would be
+    // inserted (index capacity_ only for a loaded table with no free slot).
+    struct Probe {
+      size_t index;
+      bool found;
+    };
+    Probe probe(const K& key, size_t hash) const {
+      size_t groups = capacity_ / kGroupWidth;
+      size_t group = H1(hash) & (groups - 1);
+      size_t insert_at = capacity_;
+      uint64_t probes = 0;
+      for (size_t step = 1; step <= groups; step++) {
+        size_t base = group * kGroupWidth;
+        Group g = Group::load(ctrl_ + base);
+        probes++;
+        for (uint32_t i : g.match_byte(static_cast<int8_t>(H2(hash)))) {
+          if (Policy::key(slots_[base + i]) == key) {
+            counters_.record(true, probes);
+            return { base + i, true };
+          }
+        }
+        if (insert_at == capacity_) {
+          if (auto free = g.match_empty_or_deleted()) {
+            insert_at = base + free.lowest_bit_set();
+          }
+        }
+        if (g.match_empty()) {
+          break;
+        }
+        group = (group + step) & (groups - 1);
+      }
+      counters_.record(false, probes);
+      return { insert_at, false };
+    }
+
+    static constexpr size_t kLookupBatch = 16;
+
+    template <typename F>
+    void lookup_many(std::span<const K> keys, F on_result) const {
+      size_t hashes[kLookupBatch];
+      for (size_t start = 0; start < keys.size(); start += kLookupBatch) {
+        size_t count = std::min(kLookupBatch, keys.size() - start);
+        for (size_t i = 0; i < count; i++) {
+          hashes[i] = hash_key(keys[start + i]);
+          if (capacity_ != 0) {
+            size_t index = (H1(hashes[i]) & (capacity_ / kGroupWidth - 1)) * kGroupWidth;
+            dsun::prefetch(&ctrl_[index]);
+            dsun::prefetch(&slots_[index]);
+          }
+        }
+        for (size_t i = 0; i < count; i++) {
+          on_result(start + i, probe(keys[start + i], hashes[i]));
+        }
+      }
+    }
+
+    // first empty or deleted slot on the probe sequence of `hash`. the
+    // growth limit keeps at least one slot empty, so there always is one.
+    size_t find_first_non_full(size_t hash) const {
+      size_t groups = capacity_ / kGroupWidth;
+      size_t group = H1(hash) & (groups - 1);
+      for (size_t step = 1;; step++) {
+        size_t base = group * kGroupWidth;
+        if (auto free = Group::load(ctrl_ + base).match_empty_or_deleted()) {
+          return base + free.lowest_bit_set();
+        }
+        group = (group + step) & (groups - 1);
+      }
+    }
+
+    // stores a new element in the free slot its probe ended at, rehashing
+    // first if that slot is empty and the growth budget is used up (or
+    // there was no free slot, in a full table loaded from a file). `args`
+    // go to Policy::construct. returns the slot the element landed in.
+    template <typename... Args>
+    size_t fill(size_t index, size_t hash, Args&&... args) {
+      if (index == capacity_ || (IsEmpty(ctrl_[index]) && growth_left_ == 0)) {
+        rehash_and_grow();
+        index = find_first_non_full(hash);
+      }
+      growth_left_ -= IsEmpty(ctrl_[index]);
+      Policy::construct(&slots_[index], std::forward<Args>(args)...);
+      ctrl_[index] = static_cast<ctrl_t>(H2(hash));
       len_++;
+      return index;
+    }
+
+    // if tombstones take up at least 3/32 of the slots, dropping them frees
+    // enough room that the table rehashes in place; otherwise it doubles
+    void rehash_and_grow() {
+      if (capacity_ == 0) {
+        // moved from, so there are no arrays yet
+        resize(kGroupWidth);
+      }
+      else if (len_ * 32 <= capacity_ * 25) {
+        drop_tombstones();
+      }
+      else {
+        resize(capacity_ * 2);
+      }
+    }
+
+    void resize(size_t new_capacity) {
+      ctrl_t* old_ctrl = ctrl_;
+      slots_t* old_slots = slots_;
+      size_t old_capacity = capacity_;
+      allocate(new_capacity);
+      for (size_t i = 0; i < old_capacity; i++) {
+        if (IsFull(old_ctrl[i])) {
+          size_t hash = hash_key(Policy::key(old_slots[i]));
+          size_t index = find_first_non_full(hash);
+          transfer(&slots_[index], &old_slots[i]);
+          ctrl_[index] = static_cast<ctrl_t>(H2(hash));
+        }
+      }
+      growth_left_ = growth_limit(capacity_) - len_;
+      ::operator delete(old_ctrl, std::align_val_t(kAlignment));
+    }
+
+    // rehashes without allocating. every full slot is relabelled deleted
+    // ("not placed yet") and every tombstone empty, then each unplaced slot
+    // is moved to the first free slot of its probe sequence. a key whose
+    // target is in its own group stays where it is; one whose target still
+    // holds an unplaced key swaps with it, and the swapped-in key is placed
+    // next. placed slots never move again, so every probe still ends at a
+    // group with an empty slot.
+    void drop_tombstones() {
+      for (size_t i = 0; i < capacity_; i++) {
+        ctrl_[i] = IsFull(ctrl_[i]) ? ctrl_t::Deleted : ctrl_t::Empty;
+      }
+      size_t i = 0;
+      while (i < capacity_) {
+        if (!IsDeleted(ctrl_[i])) {
+          i++;
+          continue;
+        }
+        size_t hash = hash_key(Policy::key(slots_[i]));
+        size_t target = find_first_non_full(hash);
+        auto h2 = static_cast<ctrl_t>(H2(hash));
+        if (target / kGroupWidth == i / kGroupWidth) {
+          ctrl_[i] = h2;
+          i++;
+        }
+        else if (IsEmpty(ctrl_[target])) {
+          transfer(&slots_[target], &slots_[i]);
+          ctrl_[target] = h2;
+          ctrl_[i] = ctrl_t::Empty;
+          i++;
+        }
+        else {
+          std::swap(slots_[target], slots_[i]);
+          ctrl_[target] = h2;
+        }
+      }
+      growth_left_ = growth_limit(capacity_) - len_;
+    }
+
+    // a probe moves past a group only when the group has no empty slot. if
+    // this one still has one, no probe ever went past it and the slot can
+    // go back to empty; otherwise it becomes a tombstone, which keeps the
+    // probes going and is only cleared by the next rehash.
+    void erase_at(size_t index) {
+      Policy::destroy(&slots_[index]);
+      len_--;
+      if (Group::load(ctrl_ + index / kGroupWidth * kGroupWidth).match_empty()) {
+        ctrl_[index] = ctrl_t::Empty;
+        growth_left_++;
+      }
+      else {
+        ctrl_[index] = ctrl_t::Deleted;
+      }
+    }
+
+  public:
+    // the capacity is rounded up to a power of two of at least one group
+    RawTable(size_t capacity = 16, Hash hasher = Hash()) : hasher_(std::move(hasher)) {
+      allocate(std::bit_ceil(std::max(capacity, kGroupWidth)));
+      growth_left_ = growth_limit(capacity_);
+    }
+
+    RawTable(const RawTable&) = delete;
+    RawTable& operator=(const RawTable&) = delete;
+
+    // leaves `other` with no arrays and capacity 0: lookups on it miss
+    // without touching memory and the next insert allocates
+    RawTable(RawTable&& other) noexcept
+      : ctrl_(std::exchange(other.ctrl_, nullptr)), slots_(std::exchange(other.slots_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)), len_(std::exchange(other.len_, 0)),
+      growth_left_(std::exchange(other.growth_left_, 0)), hasher_(other.hasher_), mapping_(std::move(other.mapping_)) {}
+
+    RawTable& operator=(RawTable&& other) noexcept {
+      // the swapped-in contents are released by other's destructor
+      std::swap(ctrl_, other.ctrl_);
+      std::swap(slots_, other.slots_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(len_, other.len_);
+      std::swap(growth_left_, other.growth_left_);
+      std::swap(hasher_, other.hasher_);
+      std::swap(mapping_, other.mapping_);
+      return *this;
+    }
+
+    ~RawTable() {
+      release();
+    }
+
+    // false if the key was not present
+    bool erase(const K& key) {
+      Probe found = probe(key, hash_key(key));
+      if (!found.found) {
+        return false;
+      }
+      erase_at(found.index);
       return true;
     }
 
+    bool contains(const K& key) const {
+      return probe(key, hash_key(key)).found;
+    }
+
+    // out[i] says whether keys[i] is present. returns how many are.
+    size_t contains_many(std::span<const K> keys, std::span<bool> out) const {
+      size_t count = 0;
+      lookup_many(keys, [&](size_t i, Probe found) {
+        out[i] = found.found;
+        count += found.found;
+        });
+      return count;
+    }
+
+    [[nodiscard]] size_t len() const {
+      return len_;
+    }
+
+    // load, tombstones, probe lengths and memory, from a walk over every
+    // slot that rehashes each key
+    dsun::TableStats stats() const {
+      dsun::TableStats stats;
+      stats.len = len_;
+      stats.capacity = capacity_;
+      stats.load_factor = capacity_ == 0 ? 0 : static_cast<double>(len_) / static_cast<double>(capacity_);
+      size_t groups = capacity_ / kGroupWidth;
+      for (size_t i = 0; i < capacity_; i++) {
+        if (IsDeleted(ctrl_[i])) {
+          stats.tombstones++;
+        }
+        else if (IsFull(ctrl_[i])) {
+          size_t group = H1(hash_key(Policy::key(slots_[i]))) & (groups - 1);
+          size_t length = 0;
+          while (group != i / kGroupWidth) {
+            length++;
+            group = (group + length) & (groups - 1);
+          }
+          dsun::hash_stats::add_to_histogram(stats.probe_lengths, length);
+        }
+      }
+      if (ctrl_ != nullptr && mapping_ == nullptr) {
+        stats.bytes_allocated = slots_offset(capacity_) + capacity_ * sizeof(slots_t) + len_ * Policy::kNodeBytes;
+      }
+      counters_.read(stats);
+      return stats;
+    }
+
+    // zeroes the lookup counters of stats()
+    void reset_stats() {
+      counters_.reset();
+    }
+
+    // walks ctrl bytes and slots in step; the sentinel is not empty or
+    // deleted, so skipping free slots stops there without a bounds check
     class iterator {
     private:
-      slots_t* slots_;
-      ctrl_t* ctrl_;
-      size_t index_;
-      size_t capacity_;
+      const ctrl_t* ctrl_;
+      slots_t* slot_;
     public:
-      iterator(slots_t* slots, ctrl_t* ctrl, size_t index, size_t capacity) : slots_(slots), ctrl_(ctrl), index_(index), capacity_(capacity) {}
-      iterator& operator++() {
-        do {
-          index_++;
-        } while (index_ < capacity_ && IsEmpty(ctrl_[index_]) || IsDeleted(ctrl_[index_]));
+      iterator(const ctrl_t* ctrl, slots_t* slot) : ctrl_(ctrl), slot_(slot) {}
+      iterator& skip_free() {
+        while (IsEmptyOrDeleted(*ctrl_)) {
+          ctrl_++;
+          slot_++;
+        }
         return *this;
       }
-      slots_t& operator*() {
-        return slots_[index_];
+      iterator& operator++() {
+        ctrl_++;
+        slot_++;
+        return skip_free();
       }
-      slots_t* operator->() {
-        return &slots_[index_];
+      typename Policy::reference operator*() {
+        return Policy::element(*slot_);
+      }
+      auto operator->() {
+        return &Policy::element(*slot_);
       }
       bool operator==(const iterator& other) const {
-        return index_ == other.index_;
+        return ctrl_ == other.ctrl_;
       }
       bool operator!=(const iterator& other) const {
         return !(*this == other);
       }
     };
     iterator begin() const {
-      size_t index = 0;
-      while (index < capacity_ && (IsEmpty(ctrl_[index]) || IsDeleted(ctrl_[index]))) {
-        index++;
+      if (ctrl_ == nullptr) {
+        return end();
+      }
+      return iterator(ctrl_, slots_).skip_free();
+    }
+    iterator end() const {
+      return iterator(ctrl_ + capacity_, slots_ + capacity_);
+    }
+    iterator iterator_at(size_t index) const {
+      return iterator(ctrl_ + index, slots_ + index);
+    }
+  };
+
+  // the map operations of FlatHashMap and FlatNodeHashMap, on top of RawTable
+  template <typename Policy, typename Hash, typename Group>
+  class MapTable : public RawTable<Policy, Hash, Group> {
+  private:
+    using Table = RawTable<Policy, Hash, Group>;
+    using K = typename Policy::key_type;
+    using V = typename Policy::mapped_type;
+    using Probe = typename Table::Probe;
+
+  public:
+    using Table::Table;
+
+    // false if the key is already present
+    bool insert(const K& key, V value) {
+      size_t hash = this->hash_key(key);
+      Probe found = this->probe(key, hash);
+      if (found.found) {
+        return false;
+      }
+      this->fill(found.index, hash, key, std::move(value));
+      return true;
+    }
+
+    // the slot for `key`, located by a single probe and reused by the
+    // or_insert / and_modify calls made on it. any other insert or erase
+    // on the map invalidates it. only a vacant entry holds a key of its
+    // own, so an entry for a present key copies nothing.
+    class Entry {
+    private:
+      struct Occupied {
+        size_t index;
+      };
+      struct Vacant {
+        K key;
+        size_t hash;
+        // where the probe would place the key
+        size_t index;
+      };
+
+      MapTable* map_;
+      std::variant<Occupied, Vacant> entry_;
+
+      V& value() const {
+        return Policy::value(map_->slots_[std::get<Occupied>(entry_).index]);
+      }
+    public:
+      Entry(MapTable* map, size_t index) : map_(map), entry_(Occupied{ index }) {}
+      Entry(MapTable* map, K key, size_t hash, size_t index) : map_(map), entry_(Vacant{ std::move(key), hash, index }) {}
+
+      [[nodiscard]] bool is_occupied() const {
+        return std::holds_alternative<Occupied>(entry_);
+      }
+      const K& key() const {
+        if (is_occupied()) {
+          return Policy::key(map_->slots_[std::get<Occupied>(entry_).index]);
+        }
+        return std::get<Vacant>(entry_).key;
+      }
+
+      V& or_insert(V value) {
+        if (!is_occupied()) {
+          Vacant& vacant = std::get<Vacant>(entry_);
+          size_t index = map_->fill(vacant.index, vacant.hash, std::move(vacant.key), std::move(value));
+          entry_ = Occupied{ index };
+        }
+        return this->value();
+      }
+
+      template <typename F>
+      V& or_insert_with(F f) {
+        if (!is_occupied()) {
+          return or_insert(f());
+        }
+        return value();
       }
-      return iterator(slots_, ctrl_, index, capacity_);
+
+      template <typename F>
+      Entry& and_modify(F f) {
+        if (is_occupied()) {
+          f(value());
+        }
+        return *this;
+      }
+    };
+
+    Entry entry(const K& key) {
+      size_t hash = this->hash_key(key);
+      Probe found = this->probe(key, hash);
+      if (found.found) {
+        return Entry(this, found.index);
+      }
+      return Entry(this, key, hash, found.index);
+    }
+
+    // as above, moving the key into the map on a miss
+    Entry entry(K&& key) {
+      size_t hash = this->hash_key(key);
+      Probe found = this->probe(key, hash);
+      if (found.found) {
+        return Entry(this, found.index);
+      }
+      return Entry(this, std::move(key), hash, found.index);
+    }
+
+    // the value for `key`, inserting V() first if it is absent. the key
+    // is copied and V() built only on a miss.
+    V& operator[](const K& key) {
+      return entry(key).or_insert_with([] {
+        return V();
+        });
+    }
+
+    V& operator[](K&& key) {
+      return entry(std::move(key)).or_insert_with([] {
+        return V();
+        });
+    }
+
+    // pointer to the value for `key`, or nullptr
+    V* find(const K& key) {
+      Probe found = this->probe(key, this->hash_key(key));
+      return found.found ? &Policy::value(this->slots_[found.index]) : nullptr;
+    }
+    const V* find(const K& key) const {
+      Probe found = this->probe(key, this->hash_key(key));
+      return found.found ? &Policy::value(this->slots_[found.index]) : nullptr;
+    }
+
+    // out[i] is the value for keys[i], or nullptr. the keys are hashed
+    // kLookupBatch at a time and the first ctrl byte and slot of each
+    // probe are prefetched before any of them is probed.
+    void get_many(std::span<const K> keys, std::span<const V*> out) const {
+      this->lookup_many(keys, [&](size_t i, Probe found) {
+        out[i] = found.found ? &Policy::value(this->slots_[found.index]) : nullptr;
+        });
+    }
+  };
+
+  template <typename K, typename V, typename Hash, typename Group>
+    requires KeyHasher<Hash, K> && GroupType<Group>
+  class FlatHashMap;
+
+  // a FlatHashMap saved by save() and mapped read-only from the file, from
+  // FlatHashMap::open_mapped. nothing is copied or rebuilt and pages are
+  // loaded as lookups touch them, so it offers lookups and iteration only.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>, typename Group = DefaultGroup>
+    requires KeyHasher<Hash, K> && GroupType<Group>
+  class FlatHashMapView {
+    template <typename K2, typename V2, typename H, typename G>
+      requires KeyHasher<H, K2> && GroupType<G>
+    friend class FlatHashMap;
+  private:
+    using Table = MapTable<MapPolicy<K, V>, Hash, Group>;
+    using slots_t = typename MapPolicy<K, V>::slot_type;
+
+    Table table_;
+
+    explicit FlatHashMapView(Table&& table) : table_(std::move(table)) {}
+
+  public:
+    // yields const slots with .key / .value
+    class iterator {
+    private:
+      typename Table::iterator it_;
+    public:
+      explicit iterator(typename Table::iterator it) : it_(it) {}
+      iterator& operator++() {
+        ++it_;
+        return *this;
+      }
+      const slots_t& operator*() {
+        return *it_;
+      }
+      const slots_t* operator->() {
+        return &*it_;
+      }
+      bool operator==(const iterator& other) const {
+        return it_ == other.it_;
+      }
+      bool operator!=(const iterator& other) const {
+        return it_ != other.it_;
+      }
+    };
+
+    // pointer to the value for `key`, or nullptr
+    const V* find(const K& key) const {
+      return table_.find(key);
+    }
+
+    bool contains(const K& key) const {
+      return table_.contains(key);
+    }
+
+    // out[i] is the value for keys[i], or nullptr, see FlatHashMap::get_many
+    void get_many(std::span<const K> keys, std::span<const V*> out) const {
+      table_.get_many(keys, out);
+    }
+
+    [[nodiscard]] size_t len() const {
+      return table_.len();
+    }
+
+    dsun::TableStats stats() const {
+      return table_.stats();
+    }
+
+    void reset_stats() {
+      table_.reset_stats();
+    }
+
+    iterator begin() const {
+      return iterator(table_.begin());
     }
     iterator end() const {
-      return iterator(slots_, ctrl_, capacity_, capacity_);
+      return iterator(table_.end());
+    }
+  };
+
+  // open addressing hash map storing keys and values inline in the slots.
+  // the fastest of the three tables, but a rehash moves the entries:
+  // pointers from find, and references from entry or operator[], are only
+  // valid until the next insert. iterating yields slots with .key / .value.
+  //
+  // a saved table is only readable with a group of the same width, and a
+  // hasher that hashes a fixed key the same, as the one it was written with.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>, typename Group = DefaultGroup>
+    requires KeyHasher<Hash, K> && GroupType<Group>
+  class FlatHashMap : public MapTable<MapPolicy<K, V>, Hash, Group> {
+  private:
+    using Base = MapTable<MapPolicy<K, V>, Hash, Group>;
+    using slots_t = typename MapPolicy<K, V>::slot_type;
+    static constexpr size_t kGroupWidth = Group::kWidth;
+    // 2: ctrl bytes hold H2 and keys are placed by group probing
+    // 3: the header records the group width
+    // 4: the ctrl section ends with the sentinel, free slots are zeroed
+    // 5: the header records the hasher
+    static constexpr uint32_t kFileVersion = 5;
+
+    // runs f(t) for t in [0, threads), on threads - 1 new threads and this one
+    template <typename F>
+    static void run_parallel(size_t threads, F f) {
+      std::vector<std::thread> workers;
+      for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(f, t);
+      }
+      f(0);
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    }
+
+    // places a key whose probe stays inside groups [first, last), touching
+    // no slot outside them, so regions can be filled concurrently. returns
+    // false, having changed nothing, when the probe would leave the region.
+    // the table is fresh, so there are no tombstones to reuse.
+    template <typename Merge>
+    bool insert_in_region(size_t hash, const std::pair<K, V>& item, size_t first, size_t last, Merge& merge, size_t& filled) {
+      size_t groups = this->capacity_ / kGroupWidth;
+      size_t group = H1(hash) & (groups - 1);
+      for (size_t step = 1; step <= groups; step++) {
+        if (group < first || group >= last) {
+          return false;
+        }
+        size_t base = group * kGroupWidth;
+        Group g = Group::load(this->ctrl_ + base);
+        for (uint32_t i : g.match_byte(static_cast<int8_t>(H2(hash)))) {
+          if (this->slots_[base + i].key == item.first) {
+            merge(this->slots_[base + i].value, item.second);
+            return true;
+          }
+        }
+        if (auto empty = g.match_empty()) {
+          size_t index = base + empty.lowest_bit_set();
+          MapPolicy<K, V>::construct(&this->slots_[index], item.first, item.second);
+          this->ctrl_[index] = static_cast<ctrl_t>(H2(hash));
+          filled++;
+          return true;
+        }
+        group = (group + step) & (groups - 1);
+      }
+      return false;
+    }
+
+    template <typename Merge>
+    static FlatHashMap build(std::span<const std::pair<K, V>> items, size_t threads, Merge merge, Hash hasher) {
+      size_t capacity = kGroupWidth;
+      while (Base::growth_limit(capacity) < items.size()) {
+        capacity *= 2;
+      }
+      FlatHashMap map(capacity, std::move(hasher));
+      if (threads == 0) {
+        threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+      }
+      size_t groups = capacity / kGroupWidth;
+      size_t regions = std::min(groups, std::bit_ceil(threads * 8));
+      size_t region_shift = std::countr_zero(groups) - std::countr_zero(regions);
+      auto region_of = [&](size_t hash) {
+        return (H1(hash) & (groups - 1)) >> region_shift;
+      };
+
+      // hash each chunk and count its keys per region
+      std::vector<size_t> hashes(items.size());
+      std::vector<size_t> counts(threads * regions);
+      auto chunk = [&](size_t t) {
+        return std::pair{ items.size() * t / threads, items.size() * (t + 1) / threads };
+      };
+      run_parallel(threads, [&](size_t t) {
+        auto [begin, end] = chunk(t);
+        for (size_t i = begin; i < end; i++) {
+          hashes[i] = map.hash_key(items[i].first);
+          counts[t * regions + region_of(hashes[i])]++;
+        }
+        });
+
+      // radix partition: region r's keys, in input order, at region_start[r]
+      std::vector<size_t> region_start(regions + 1);
+      size_t offset = 0;
+      for (size_t r = 0; r < regions; r++) {
+        region_start[r] = offset;
+        for (size_t t = 0; t < threads; t++) {
+          size_t count = counts[t * regions + r];
+          counts[t * regions + r] = offset;
+          offset += count;
+        }
+      }
+      region_start[regions] = offset;
+      std::vector<size_t> order(items.size());
+      run_parallel(threads, [&](size_t t) {
+        auto [begin, end] = chunk(t);
+        for (size_t i = begin; i < end; i++) {
+          order[counts[t * regions + region_of(hashes[i])]++] = i;
+        }
+        });
+
+      // each region is filled by one thread, which owns all of its slots
+      std::vector<std::vector<size_t>> deferred(regions);
+      std::vector<size_t> filled(regions);
+      run_parallel(threads, [&](size_t t) {
+        for (size_t r = t; r < regions; r += threads) {
+          size_t first = r << region_shift;
+          size_t last = (r + 1) << region_shift;
+          for (size_t k = region_start[r]; k < region_start[r + 1]; k++) {
+            size_t i = order[k];
+            if (!map.insert_in_region(hashes[i], items[i], first, last, merge, filled[r])) {
+              deferred[r].push_back(i);
+            }
+          }
+        }
+        });
+      for (size_t count : filled) {
+        map.len_ += count;
+        map.growth_left_ -= count;
+      }
+
+      // keys whose probe crosses into another region go in one at a time
+      for (const auto& keys : deferred) {
+        for (size_t i : keys) {
+          auto found = map.probe(items[i].first, hashes[i]);
+          if (found.found) {
+            merge(map.slots_[found.index].value, items[i].second);
+          }
+          else {
+            map.fill(found.index, hashes[i], items[i].first, items[i].second);
+          }
+        }
+      }
+      return map;
     }
-    iterator iterator_at(size_t index)const {
-      return iterator(slots_, ctrl_, index, capacity_);
+
+    static dsun::table_file::Header file_header(const Hash& hasher) {
+      auto header = dsun::table_file::make_header("DSUNFLAT", kFileVersion, sizeof(K), sizeof(V), sizeof(slots_t));
+      header.layout = kGroupWidth;
+      header.hasher_id = dsun::table_file::hasher_id<K>(hasher);
+      return header;
+    }
+
+    // the header of a saved table whose sections are all inside the file
+    static std::optional<dsun::table_file::Header> check_file(const dsun::table_file::Mapping& file, const Hash& hasher) {
+      auto header = dsun::table_file::read_header(file.data(), file.size(), file_header(hasher));
+      if (!header.has_value() || header->capacity < kGroupWidth || !std::has_single_bit(header->capacity)
+        || header->len > header->capacity
+        || !dsun::table_file::fits(*header, header->ctrl_offset, header->capacity + 1)
+        || !dsun::table_file::fits(*header, header->records_offset, header->capacity * sizeof(slots_t))
+        || static_cast<ctrl_t>(file.data()[header->ctrl_offset + header->capacity]) != ctrl_t::Sentinel) {
+        return std::nullopt;
+      }
+      return header;
+    }
+  public:
+    using Base::Base;
+
+    // writes the ctrl bytes and the slot array as they are in memory, so
+    // a table read back, or mapped, probes exactly like this one. free
+    // slots are uninitialized and written as zeros. returns false on an
+    // i/o error.
+    bool save(const char* path) const
+      requires std::is_trivially_copyable_v<slots_t> {
+      if (this->capacity_ == 0) {
+        return FlatHashMap(kGroupWidth, this->hasher_).save(path);
+      }
+      dsun::table_file::Header header = file_header(this->hasher_);
+      header.capacity = this->capacity_;
+      header.len = this->len_;
+      header.ctrl_offset = dsun::table_file::align_up(sizeof(header));
+      header.records_offset = dsun::table_file::align_up(header.ctrl_offset + this->capacity_ + 1);
+      header.file_size = header.records_offset + this->capacity_ * sizeof(slots_t);
+      dsun::table_file::Writer writer(path);
+      writer.write(&header, sizeof(header));
+      writer.pad_to(header.ctrl_offset);
+      writer.write(this->ctrl_, this->capacity_ + 1);
+      // runs of full slots, with zeros in between
+      size_t i = 0;
+      while (i < this->capacity_) {
+        size_t run = i;
+        while (run < this->capacity_ && IsFull(this->ctrl_[run])) {
+          run++;
+        }
+        if (run > i) {
+          writer.pad_to(header.records_offset + i * sizeof(slots_t));
+          writer.write(&this->slots_[i], (run - i) * sizeof(slots_t));
+        }
+        i = run + 1;
+      }
+      writer.pad_to(header.file_size);
+      return writer.finish();
+    }
+
+    // a heap copy of a table saved by save(), or nullopt if the file is
+    // missing, truncated or was written for other key / value types or
+    // another hasher
+    static std::optional<FlatHashMap> load(const char* path, Hash hasher = Hash())
+      requires std::is_trivially_copyable_v<slots_t> {
+      auto file = dsun::table_file::Mapping::open(path);
+      if (!file.has_value()) {
+        return std::nullopt;
+      }
+      auto header = check_file(*file, hasher);
+      if (!header.has_value()) {
+        return std::nullopt;
+      }
+      FlatHashMap map(header->capacity, std::move(hasher));
+      std::memcpy(map.ctrl_, file->data() + header->ctrl_offset, header->capacity);
+      std::memcpy(static_cast<void*>(map.slots_), file->data() + header->records_offset, header->capacity * sizeof(slots_t));
+      map.len_ = header->len;
+      map.reset_growth_left();
+      return map;
+    }
+
+    // a read-only view that probes straight in the mapped file, or nullopt
+    // in the same cases as load()
+    static std::optional<FlatHashMapView<K, V, Hash, Group>> open_mapped(const char* path, Hash hasher = Hash())
+      requires std::is_trivially_copyable_v<slots_t> {
+      auto file = dsun::table_file::Mapping::open(path);
+      if (!file.has_value()) {
+        return std::nullopt;
+      }
+      auto header = check_file(*file, hasher);
+      if (!header.has_value()) {
+        return std::nullopt;
+      }
+      auto mapping = std::make_unique<dsun::table_file::Mapping>(std::move(file.value()));
+      auto* ctrl = reinterpret_cast<ctrl_t*>(const_cast<unsigned char*>(mapping->data() + header->ctrl_offset));
+      auto* slots = reinterpret_cast<slots_t*>(const_cast<unsigned char*>(mapping->data() + header->records_offset));
+      return FlatHashMapView<K, V, Hash, Group>(Base(ctrl, slots, header->capacity, header->len, std::move(hasher), std::move(mapping)));
+    }
+
+    enum class OnDuplicate {
+      KeepFirst,
+      KeepLast,
+    };
+
+    // builds a table from `items` on `threads` threads (0: one per core).
+    // keys are hashed in parallel and radix-partitioned on the top bits of
+    // their first group into regions of the table, and each region is
+    // filled by a single thread with plain stores. a key whose probe runs
+    // out of its region is inserted afterwards, sequentially.
+    // the table probes exactly as one built by insert would, and later
+    // inserts and erases work as usual.
+    static FlatHashMap bulk_build(std::span<const std::pair<K, V>> items, size_t threads = 0,
+      OnDuplicate on_duplicate = OnDuplicate::KeepLast, Hash hasher = Hash()) {
+      if (on_duplicate == OnDuplicate::KeepFirst) {
+        return build(items, threads, [](V&, const V&) {}, std::move(hasher));
+      }
+      return build(items, threads, [](V& stored, const V& value) {
+        stored = value;
+        }, std::move(hasher));
+    }
+
+    // as above, with combine(V& stored, const V& value) called for each
+    // repeat of a key, in input order. calls for different keys may run
+    // at the same time on different threads.
+    template <typename F>
+      requires std::invocable<F&, V&, const V&>
+    static FlatHashMap bulk_build(std::span<const std::pair<K, V>> items, size_t threads, F combine, Hash hasher = Hash()) {
+      return build(items, threads, combine, std::move(hasher));
+    }
+  };
+
+  // FlatHashMap whose slots point at heap nodes: a rehash moves only the
+  // pointers, so pointers and references to keys and values stay valid
+  // until their entry is erased. costs an allocation per insert and a
+  // pointer chase per lookup. iterating yields nodes with .key / .value.
+  template <typename K, typename V, typename Hash = dsun::Hash<K>, typename Group = DefaultGroup>
+    requires KeyHasher<Hash, K> && GroupType<Group>
+  class FlatNodeHashMap : public MapTable<NodePolicy<K, V>, Hash, Group> {
+  public:
+    using MapTable<NodePolicy<K, V>, Hash, Group>::MapTable;
+  };
+
+  // swiss table set: the slots hold only keys. iterating yields const K&.
+  template <typename K, typename Hash = dsun::Hash<K>, typename Group = DefaultGroup>
+    requires KeyHasher<Hash, K> && GroupType<Group>
+  class FlatHashSet : public RawTable<SetPolicy<K>, Hash, Group> {
+  private:
+    using Table = RawTable<SetPolicy<K>, Hash, Group>;
+  public:
+    using Table::Table;
+
+    // false if the key is already present
+    bool insert(const K& key) {
+      size_t hash = this->hash_key(key);
+      auto found = this->probe(key, hash);
+      if (found.found) {
+        return false;
+      }
+      this->fill(found.index, hash, key);
+      return true;
     }
   };
 }
 
-#endif // DSUN_SWISSTABLE_H
\ No newline at end of file
+#endif // DSUN_SWISSTABLE_H
@@ -0,0 +1,243 @@
+#ifndef DSUN_TABLE_FILE_H
+#define DSUN_TABLE_FILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dsun {
+
+  // on-disk format shared by the hash tables' save / load.
+  //
+  // a file is a Header followed by sections at the offsets it records.
+  // every section starts on a kAlignment boundary, so a table mapped
+  // straight from the file has its arrays as aligned as in memory.
+  // numbers are in the writer's byte order, a file from a machine of the
+  // other endianness is rejected rather than converted.
+  namespace table_file {
+    static constexpr uint32_t kEndianTag = 0x01020304;
+    static constexpr size_t kAlignment = 64;
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t endian_tag;
+      uint32_t key_size;
+      uint32_t value_size;
+      uint32_t record_size;
+      // a per-kind layout parameter (FlatHashMap: the group width), 0 if unused
+      uint32_t layout;
+      uint64_t capacity;
+      uint64_t len;
+      // offsets from the start of the file
+      uint64_t ctrl_offset;
+      uint64_t records_offset;
+      uint64_t file_size;
+      // see hasher_id
+      uint64_t hasher_id;
+    };
+
+    inline uint64_t align_up(uint64_t offset) {
+      return (offset + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // the hash the table's hasher gives one fixed key, so that a reader
+    // with another hasher, or another seed, rejects the file instead of
+    // missing every lookup. 0 when K has no value to hash without a table.
+    template <typename K, typename Hash>
+    uint64_t hasher_id(const Hash& hasher) {
+      if constexpr (std::is_integral_v<K>) {
+        return static_cast<uint64_t>(hasher(static_cast<K>(0x2545F4914F6CDD1Dull)));
+      }
+      else if constexpr (std::is_default_constructible_v<K>) {
+        return static_cast<uint64_t>(hasher(K{}));
+      }
+      else {
+        return 0;
+      }
+    }
+
+    // `version` is per table kind, bumped whenever its layout or probing changes
+    inline Header make_header(const char (&magic)[9], uint32_t version, size_t key_size, size_t value_size, size_t record_size) {
+      Header header{};
+      std::memcpy(header.magic, magic, sizeof(header.magic));
+      header.version = version;
+      header.endian_tag = kEndianTag;
+      header.key_size = static_cast<uint32_t>(key_size);
+      header.value_size = static_cast<uint32_t>(value_size);
+      header.record_size = static_cast<uint32_t>(record_size);
+      return header;
+    }
+
+    // checks everything but the offsets against what the reader expects
+    inline bool matches(const Header& header, const Header& expected) {
+      return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+        && header.version == expected.version
+        && header.endian_tag == expected.endian_tag
+        && header.key_size == expected.key_size
+        && header.value_size == expected.value_size
+        && header.record_size == expected.record_size
+        && header.layout == expected.layout
+        && header.hasher_id == expected.hasher_id;
+    }
+
+    // writes sequentially, padding with zeros up to each section offset
+    class Writer {
+    private:
+      std::FILE* file;
+      uint64_t offset = 0;
+      bool ok;
+    public:
+      explicit Writer(const char* path) : file(std::fopen(path, "wb")), ok(file != nullptr) {}
+      Writer(const Writer&) = delete;
+      Writer& operator=(const Writer&) = delete;
+      ~Writer() {
+        if (file != nullptr) {
+          std::fclose(file);
+        }
+      }
+
+      void write(const void* data, size_t size) {
+        if (ok && size != 0) {
+          ok = std::fwrite(data, 1, size, file) == size;
+          offset += size;
+        }
+      }
+      void pad_to(uint64_t target) {
+        static const char zeros[kAlignment] = {};
+        while (ok && offset < target) {
+          write(zeros, static_cast<size_t>(std::min<uint64_t>(target - offset, kAlignment)));
+        }
+      }
+      // flushes and closes; false if anything failed along the way
+      bool finish() {
+        if (file != nullptr) {
+          ok = std::fclose(file) == 0 && ok;
+          file = nullptr;
+        }
+        return ok;
+      }
+    };
+
+    // the whole file in memory, for load()
+    inline std::optional<std::vector<unsigned char>> read_all(const char* path) {
+      std::FILE* file = std::fopen(path, "rb");
+      if (file == nullptr) {
+        return std::nullopt;
+      }
+      std::vector<unsigned char> bytes;
+      unsigned char buffer[1 << 16];
+      size_t read;
+      while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+      }
+      bool failed = std::ferror(file) != 0;
+      std::fclose(file);
+      if (failed) {
+        return std::nullopt;
+      }
+      return bytes;
+    }
+
+    // a read-only mapping of a whole file. without mmap (windows) the file
+    // is read into an owned buffer instead, which keeps the same interface.
+    class Mapping {
+    private:
+      const unsigned char* data_ = nullptr;
+      size_t size_ = 0;
+      std::vector<unsigned char> owned;
+
+      Mapping() = default;
+    public:
+      Mapping(const Mapping&) = delete;
+      Mapping& operator=(const Mapping&) = delete;
+      Mapping(Mapping&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)), owned(std::move(other.owned)) {}
+      Mapping& operator=(Mapping&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(owned, other.owned);
+        return *this;
+      }
+      ~Mapping() {
+#ifndef _WIN32
+        if (data_ != nullptr && owned.empty()) {
+          ::munmap(const_cast<unsigned char*>(data_), size_);
+        }
+#endif
+      }
+
+      static std::optional<Mapping> open(const char* path) {
+        Mapping mapping;
+#ifndef _WIN32
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+          return std::nullopt;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+          ::close(fd);
+          return std::nullopt;
+        }
+        void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+          return std::nullopt;
+        }
+        mapping.data_ = static_cast<const unsigned char*>(data);
+        mapping.size_ = static_cast<size_t>(info.st_size);
+#else
+        auto bytes = read_all(path);
+        if (!bytes.has_value() || bytes->empty()) {
+          return std::nullopt;
+        }
+        mapping.owned = std::move(bytes.value());
+        mapping.data_ = mapping.owned.data();
+        mapping.size_ = mapping.owned.size();
+#endif
+        return mapping;
+      }
+
+      const unsigned char* data() const {
+        return data_;
+      }
+      size_t size() const {
+        return size_;
+      }
+    };
+
+    // the header at the start of `bytes`, if it is the expected kind
+    inline std::optional<Header> read_header(const unsigned char* bytes, size_t size, const Header& expected) {
+      if (size < sizeof(Header)) {
+        return std::nullopt;
+      }
+      Header header;
+      std::memcpy(&header, bytes, sizeof(Header));
+      if (!matches(header, expected) || header.file_size != size
+        || header.ctrl_offset % kAlignment != 0 || header.records_offset % kAlignment != 0) {
+        return std::nullopt;
+      }
+      return header;
+    }
+
+    // whether [offset, offset + length) lies inside the file
+    inline bool fits(const Header& header, uint64_t offset, uint64_t length) {
+      return offset <= header.file_size && length <= header.file_size - offset;
+    }
+  }
+}
+
+#endif // DSUN_TABLE_FILE_H
@@ -0,0 +1,427 @@
+#ifndef DSUN_UNROLLED_LIST_H
+#define DSUN_UNROLLED_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "utils.h"
+
+namespace dsun {
+
+  // doubly linked list of chunks, each chunk holding up to B elements
+  // contiguously. walking the list costs one pointer chase per chunk
+  // instead of one per element, and an edit in the middle only shifts
+  // the elements of a single chunk.
+  //
+  // invariants:
+  //   - no chunk is empty
+  //   - a chunk that overflows is split in two halves
+  //   - a chunk that drops below B / 2 elements borrows from or merges
+  //     with its successor, or with its predecessor if it is the last
+  //     chunk, so only a list of one chunk has a chunk under half full
+  //     after a removal
+  template <typename T, size_t B = 64>
+  class UnrolledList {
+    static_assert(B >= 2, "chunks must hold at least two elements");
+  private:
+    struct Chunk {
+      alignas(T) unsigned char storage[B * sizeof(T)];
+      size_t count = 0;
+      Chunk* prev = nullptr;
+      Chunk* next = nullptr;
+
+      T* items() {
+        return std::launder(reinterpret_cast<T*>(storage));
+      }
+      T& item(size_t i) {
+        return items()[i];
+      }
+      bool is_full() const {
+        return count == B;
+      }
+
+      // opens a hole at `at` by shifting [at, count) one position right
+      void open_gap(size_t at) {
+        if (at == count) {
+          return;
+        }
+        new (&items()[count]) T(std::move(item(count - 1)));
+        for (size_t i = count - 1; i > at; i--) {
+          item(i) = std::move(item(i - 1));
+        }
+        item(at).~T();
+      }
+
+      // closes the hole at `at` by shifting (at, count) one position left
+      void close_gap(size_t at) {
+        if (at + 1 == count) {
+          return;
+        }
+        new (&items()[at]) T(std::move(item(at + 1)));
+        for (size_t i = at + 1; i + 1 < count; i++) {
+          item(i) = std::move(item(i + 1));
+        }
+        item(count - 1).~T();
+      }
+
+      void insert(size_t at, T value) {
+        open_gap(at);
+        new (&items()[at]) T(std::move(value));
+        count++;
+      }
+
+      T remove(size_t at) {
+        T value = std::move(item(at));
+        item(at).~T();
+        close_gap(at);
+        count--;
+        return value;
+      }
+
+      // moves [from, count) to the end of `other`
+      void move_tail_to(size_t from, Chunk* other) {
+        for (size_t i = from; i < count; i++) {
+          new (&other->items()[other->count++]) T(std::move(item(i)));
+          item(i).~T();
+        }
+        count = from;
+      }
+
+      void clear() {
+        for (size_t i = 0; i < count; i++) {
+          item(i).~T();
+        }
+        count = 0;
+      }
+    };
+
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    size_t size = 0;
+    size_t chunks = 0;
+
+  public:
+    UnrolledList() = default;
+
+    UnrolledList(const UnrolledList<T, B>& other) {
+      for (const auto& item : other) {
+        push_back(item);
+      }
+    }
+
+    UnrolledList(UnrolledList<T, B>&& other) noexcept
+      : head(other.head), tail(other.tail), size(other.size), chunks(other.chunks) {
+      other.head = nullptr;
+      other.tail = nullptr;
+      other.size = 0;
+      other.chunks = 0;
+    }
+
+    UnrolledList<T, B>& operator=(UnrolledList<T, B> other) {
+      std::swap(head, other.head);
+      std::swap(tail, other.tail);
+      std::swap(size, other.size);
+      std::swap(chunks, other.chunks);
+      return *this;
+    }
+
+    ~UnrolledList() {
+      clear();
+    }
+
+    static UnrolledList<T, B> from_list(std::initializer_list<T> list) {
+      UnrolledList<T, B> unrolled;
+      for (const auto& item : list) {
+        unrolled.push_back(item);
+      }
+      return unrolled;
+    }
+
+    void push_back(const T& data) {
+      if (tail == nullptr || tail->is_full()) {
+        // copied before the chunk is linked, so a throwing copy leaves no empty chunk
+        T value(data);
+        link_after(tail, new Chunk());
+        tail->insert(0, std::move(value));
+      }
+      else {
+        tail->insert(tail->count, data);
+      }
+      size++;
+    }
+
+    void push_front(const T& data) {
+      if (head == nullptr || head->is_full()) {
+        T value(data);
+        link_after(nullptr, new Chunk());
+        head->insert(0, std::move(value));
+      }
+      else {
+        head->insert(0, data);
+      }
+      size++;
+    }
+
+    std::optional<T> pop_back() {
+      if (is_empty()) {
+        return std::nullopt;
+      }
+      T value = tail->remove(tail->count - 1);
+      size--;
+      rebalance(tail);
+      return std::optional<T>(std::move(value));
+    }
+
+    std::optional<T> pop_front() {
+      if (is_empty()) {
+        return std::nullopt;
+      }
+      T value = head->remove(0);
+      size--;
+      rebalance(head);
+      return std::optional<T>(std::move(value));
+    }
+
+    void insert(size_t at, const T& data) {
+      if (at > size) {
+        throw std::out_of_range("Index out of range: " + dsun_utils::to_string(at));
+      }
+      if (at == size) {
+        push_back(data);
+        return;
+      }
+      auto [chunk, offset] = locate(at);
+      if (chunk->is_full()) {
+        Chunk* upper = split(chunk);
+        if (offset > chunk->count) {
+          offset -= chunk->count;
+          chunk = upper;
+        }
+      }
+      chunk->insert(offset, data);
+      size++;
+    }
+
+    T remove(size_t at) {
+      if (at >= size) {
+        throw std::out_of_range("Index out of range: " + dsun_utils::to_string(at));
+      }
+      auto [chunk, offset] = locate(at);
+      T value = chunk->remove(offset);
+      size--;
+      rebalance(chunk);
+      return value;
+    }
+
+    size_t len() const {
+      return size;
+    }
+
+    bool is_empty() const {
+      return size == 0;
+    }
+
+    size_t chunk_count() const {
+      return chunks;
+    }
+
+    std::optional<T> front() const {
+      if (is_empty()) {
+        return std::nullopt;
+      }
+      return head->item(0);
+    }
+
+    std::optional<T> back() const {
+      if (is_empty()) {
+        return std::nullopt;
+      }
+      return tail->item(tail->count - 1);
+    }
+
+    std::optional<T> at(size_t index) const {
+      if (index >= size) {
+        return std::nullopt;
+      }
+      auto [chunk, offset] = locate(index);
+      return chunk->item(offset);
+    }
+
+    std::optional<T*> at_mut(size_t index) {
+      if (index >= size) {
+        return std::nullopt;
+      }
+      auto [chunk, offset] = locate(index);
+      return &chunk->item(offset);
+    }
+
+    T& operator[](size_t index) {
+      if (index >= size) {
+        throw std::out_of_range("Index out of range" + dsun_utils::to_string(index));
+      }
+      auto [chunk, offset] = locate(index);
+      return chunk->item(offset);
+    }
+
+    void clear() {
+      Chunk* chunk = head;
+      while (chunk != nullptr) {
+        Chunk* next = chunk->next;
+        chunk->clear();
+        delete chunk;
+        chunk = next;
+      }
+      head = nullptr;
+      tail = nullptr;
+      size = 0;
+      chunks = 0;
+    }
+
+    class Iterator {
+    private:
+      Chunk* chunk;
+      size_t offset;
+      size_t index_;
+    public:
+      Iterator(Chunk* chunk) : chunk(chunk), offset(0), index_(0) {}
+      T operator*() const {
+        return chunk->item(offset);
+      }
+      T& get_mut() {
+        return chunk->item(offset);
+      }
+      Iterator& operator++() {
+        index_++;
+        if (++offset == chunk->count) {
+          chunk = chunk->next;
+          offset = 0;
+        }
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const {
+        return chunk != other.chunk || offset != other.offset;
+      }
+      bool operator==(const Iterator& other) const {
+        return chunk == other.chunk && offset == other.offset;
+      }
+      size_t index() const {
+        return index_;
+      }
+      bool has_next() const {
+        return chunk != nullptr;
+      }
+    };
+
+    Iterator begin() const {
+      return Iterator(head);
+    }
+    Iterator end() const {
+      return Iterator(nullptr);
+    }
+
+  private:
+    // finds the chunk holding `index` and the offset inside it, walking
+    // from whichever end of the list is closer
+    std::pair<Chunk*, size_t> locate(size_t index) const {
+      if (index < size / 2) {
+        Chunk* chunk = head;
+        while (index >= chunk->count) {
+          index -= chunk->count;
+          chunk = chunk->next;
+        }
+        return { chunk, index };
+      }
+      size_t from_end = size - index;
+      Chunk* chunk = tail;
+      while (from_end > chunk->count) {
+        from_end -= chunk->count;
+        chunk = chunk->prev;
+      }
+      return { chunk, chunk->count - from_end };
+    }
+
+    void link_after(Chunk* prev, Chunk* chunk) {
+      chunk->prev = prev;
+      chunk->next = prev ? prev->next : head;
+      if (chunk->next) {
+        chunk->next->prev = chunk;
+      }
+      else {
+        tail = chunk;
+      }
+      if (prev) {
+        prev->next = chunk;
+      }
+      else {
+        head = chunk;
+      }
+      chunks++;
+    }
+
+    void unlink(Chunk* chunk) {
+      if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+      }
+      else {
+        head = chunk->next;
+      }
+      if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+      }
+      else {
+        tail = chunk->prev;
+      }
+      delete chunk;
+      chunks--;
+    }
+
+    // moves the upper half of a full chunk into a new successor
+    Chunk* split(Chunk* chunk) {
+      Chunk* upper = new Chunk();
+      chunk->move_tail_to(B / 2, upper);
+      link_after(chunk, upper);
+      return upper;
+    }
+
+    // restores the fill invariant after a removal from `chunk`
+    void rebalance(Chunk* chunk) {
+      if (chunk->count >= B / 2) {
+        return;
+      }
+      Chunk* next = chunk->next;
+      if (next == nullptr) {
+        rebalance_last(chunk);
+        return;
+      }
+      if (chunk->count + next->count <= B) {
+        next->move_tail_to(0, chunk);
+        unlink(next);
+        return;
+      }
+      chunk->insert(chunk->count, next->remove(0));
+    }
+
+    // the last chunk has no successor, so it leans on its predecessor
+    void rebalance_last(Chunk* chunk) {
+      Chunk* prev = chunk->prev;
+      if (prev == nullptr) {
+        if (chunk->count == 0) {
+          unlink(chunk);
+        }
+        return;
+      }
+      if (prev->count + chunk->count <= B) {
+        chunk->move_tail_to(0, prev);
+        unlink(chunk);
+        return;
+      }
+      chunk->insert(0, prev->remove(prev->count - 1));
+    }
+  };
+}
+
+#endif // DSUN_UNROLLED_LIST_H
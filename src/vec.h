@@ -235,10 +235,10 @@ namespace dsun {
         if (length == cap) {
             cap *= 2;
             auto new_ptr = std::make_unique<T[]>(cap);
-            std::copy(ptr.get(), ptr.get() + length, new_ptr.get());
+            std::move(ptr.get(), ptr.get() + length, new_ptr.get());
             ptr = std::move(new_ptr);
         }
-        ptr.get()[length++] = value;
+        ptr.get()[length++] = std::move(value);
     }
 
     template <class T>
@@ -0,0 +1,25 @@
+#ifndef DSUN_TESTS_HASH_COUNTED_KEY_H
+#define DSUN_TESTS_HASH_COUNTED_KEY_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// key that counts how often it is hashed
+struct HashCountedKey {
+  static inline std::atomic<int> hashes = 0;
+  int value;
+  bool operator==(const HashCountedKey& other) const {
+    return value == other.value;
+  }
+};
+
+template <>
+struct std::hash<HashCountedKey> {
+  size_t operator()(const HashCountedKey& key) const {
+    HashCountedKey::hashes++;
+    return static_cast<size_t>(key.value);
+  }
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/cache.h"
+#include "hash_counted_key.h"
+
+using namespace dsun;
+
+TEST(CacheTest, GetAndPut) {
+  Cache<int, std::string> cache(4);
+  EXPECT_TRUE(cache.put(1, "one"));
+  EXPECT_TRUE(cache.put(2, "two"));
+  EXPECT_EQ(cache.get(1).value(), "one");
+  EXPECT_EQ(cache.get(2).value(), "two");
+  EXPECT_FALSE(cache.get(3).has_value());
+  EXPECT_EQ(cache.len(), 2);
+
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.insertions, 2);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST(CacheTest, PutReplacesValue) {
+  Cache<int, std::string> cache(4);
+  cache.put(1, "one");
+  cache.put(1, "uno");
+  EXPECT_EQ(cache.len(), 1);
+  EXPECT_EQ(cache.get(1).value(), "uno");
+  EXPECT_EQ(cache.stats().insertions, 1);
+}
+
+TEST(CacheTest, Remove) {
+  Cache<int, int> cache(4);
+  cache.put(1, 10);
+  cache.put(2, 20);
+  EXPECT_EQ(cache.remove(1).value(), 10);
+  EXPECT_FALSE(cache.remove(1).has_value());
+  EXPECT_FALSE(cache.contains(1));
+  EXPECT_TRUE(cache.contains(2));
+  EXPECT_EQ(cache.len(), 1);
+}
+
+TEST(CacheTest, Clear) {
+  Cache<int, int, S3FIFO> cache(8);
+  for (int i = 0; i < 8; i++) {
+    cache.put(i, i);
+  }
+  cache.clear();
+  EXPECT_TRUE(cache.is_empty());
+  EXPECT_EQ(cache.weight(), 0);
+  cache.put(1, 1);
+  EXPECT_EQ(cache.get(1).value(), 1);
+}
+
+TEST(CacheTest, LRUEvictsLeastRecentlyUsed) {
+  Cache<int, int, LRU> cache(3);
+  cache.put(1, 1);
+  cache.put(2, 2);
+  cache.put(3, 3);
+  cache.get(1);
+  cache.put(4, 4);
+  EXPECT_TRUE(cache.contains(1));
+  EXPECT_FALSE(cache.contains(2));
+  EXPECT_TRUE(cache.contains(3));
+  EXPECT_TRUE(cache.contains(4));
+  EXPECT_EQ(cache.stats().evictions, 1);
+}
+
+TEST(CacheTest, ClockGivesSecondChance) {
+  Cache<int, int, Clock> cache(3);
+  cache.put(1, 1);
+  cache.put(2, 2);
+  cache.put(3, 3);
+  cache.get(1);
+  cache.put(4, 4);
+  EXPECT_TRUE(cache.contains(1));
+  EXPECT_FALSE(cache.contains(2));
+  cache.put(5, 5);
+  EXPECT_FALSE(cache.contains(3));
+  EXPECT_EQ(cache.len(), 3);
+}
+
+TEST(CacheTest, S3FIFODropsOneHitWonders) {
+  Cache<int, int, S3FIFO> cache(10);
+  for (int i = 0; i < 5; i++) {
+    cache.put(i, i);
+    cache.get(i);
+  }
+  // a scan of keys that are never read again
+  for (int i = 100; i < 200; i++) {
+    cache.put(i, i);
+  }
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(cache.contains(i)) << i;
+  }
+  EXPECT_LE(cache.len(), 10);
+}
+
+TEST(CacheTest, S3FIFOGhostHitGoesToMain) {
+  Cache<int, int, S3FIFO> cache(10);
+  cache.put(1, 1);
+  for (int i = 100; i < 110; i++) {
+    cache.put(i, i);
+  }
+  EXPECT_FALSE(cache.contains(1));
+  // 1 is remembered by the ghost queue, so it now survives a scan
+  cache.put(1, 1);
+  for (int i = 200; i < 205; i++) {
+    cache.put(i, i);
+  }
+  EXPECT_TRUE(cache.contains(1));
+}
+
+TEST(CacheTest, S3FIFOPutOnWarmCacheKeepsNewKey) {
+  Cache<int, int, S3FIFO> cache(10);
+  for (int i = 0; i < 10; i++) {
+    cache.put(i, i);
+  }
+  for (int i = 0; i < 10; i++) {
+    cache.get(i);
+  }
+  for (int i = 100; i < 120; i++) {
+    EXPECT_TRUE(cache.put(i, i));
+    EXPECT_EQ(cache.get(i).value(), i) << i;
+  }
+  EXPECT_EQ(cache.len(), 10);
+}
+
+TEST(CacheTest, ByteSizeCapacity) {
+  Cache<int, std::string, LRU, cache::ByteSize> cache(3 * (sizeof(int) + sizeof(std::string)) + 30);
+  cache.put(1, std::string(10, 'a'));
+  cache.put(2, std::string(10, 'b'));
+  cache.put(3, std::string(10, 'c'));
+  EXPECT_EQ(cache.len(), 3);
+  cache.put(4, std::string(10, 'd'));
+  EXPECT_EQ(cache.len(), 3);
+  EXPECT_FALSE(cache.contains(1));
+  EXPECT_LE(cache.weight(), cache.capacity());
+
+  // growing an entry evicts others to make room
+  cache.put(4, std::string(20, 'd'));
+  EXPECT_EQ(cache.len(), 2);
+  EXPECT_LE(cache.weight(), cache.capacity());
+  EXPECT_FALSE(cache.put(5, std::string(1000, 'e')));
+}
+
+TEST(ShardedCacheTest, ConcurrentAccess) {
+  ShardedCache<int, int, S3FIFO, cache::EntryCount, 8> cache(1024);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 5000; i++) {
+        int key = (i * 7 + t) % 2000;
+        if (!cache.get(key).has_value()) {
+          cache.put(key, key * 2);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(cache.len(), 1024);
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits + stats.misses, 20000);
+  for (int key = 0; key < 2000; key++) {
+    auto value = cache.get(key);
+    if (value.has_value()) {
+      EXPECT_EQ(value.value(), key * 2);
+    }
+  }
+}
+
+TEST(ShardedCacheTest, HashesEachKeyOnce) {
+  ShardedCache<HashCountedKey, int> cache(64);
+  HashCountedKey::hashes = 0;
+  EXPECT_TRUE(cache.put(HashCountedKey{ 1 }, 1));
+  EXPECT_TRUE(cache.put(HashCountedKey{ 1 }, 2));
+  EXPECT_EQ(cache.get(HashCountedKey{ 1 }).value(), 2);
+  EXPECT_TRUE(cache.contains(HashCountedKey{ 1 }));
+  EXPECT_EQ(cache.remove(HashCountedKey{ 1 }).value(), 2);
+  EXPECT_EQ(HashCountedKey::hashes, 5);
+  // evictions reuse the hash stored in the entry
+  for (int i = 0; i < 1000; i++) {
+    cache.put(HashCountedKey{ i }, i);
+  }
+  EXPECT_EQ(HashCountedKey::hashes, 1005);
+}
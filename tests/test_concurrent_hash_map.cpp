@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/concurrent_hash_map.h"
+#include "hash_counted_key.h"
+
+using namespace dsun;
+
+TEST(ConcurrentHashMapTest, Basic) {
+  ConcurrentHashMap<int, std::string> map;
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_TRUE(map.insert(1, "one"));
+  EXPECT_TRUE(map.insert(2, "two"));
+  EXPECT_FALSE(map.insert(1, "uno"));
+  EXPECT_EQ(map.len(), 2);
+  EXPECT_EQ(map.get(1).value(), "uno");
+  EXPECT_TRUE(map.contains_key(2));
+  EXPECT_FALSE(map.get(3).has_value());
+  EXPECT_EQ(map.remove(2).value(), "two");
+  EXPECT_FALSE(map.contains_key(2));
+  map.clear();
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(ConcurrentHashMapTest, UpsertAndComputeIfAbsent) {
+  ConcurrentHashMap<std::string, int, 4> map;
+  EXPECT_TRUE(map.upsert("a", 1, [](int& v) { v++; }));
+  EXPECT_FALSE(map.upsert("a", 1, [](int& v) { v++; }));
+  EXPECT_EQ(map.get("a").value(), 2);
+
+  int calls = 0;
+  auto make = [&]() {
+    calls++;
+    return 10;
+  };
+  EXPECT_EQ(map.compute_if_absent("b", make), 10);
+  EXPECT_EQ(map.compute_if_absent("b", make), 10);
+  EXPECT_EQ(map.compute_if_absent("a", make), 2);
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(ConcurrentHashMapTest, ForEach) {
+  ConcurrentHashMap<int, int, 8> map;
+  for (int i = 0; i < 1000; i++) {
+    map.insert(i, i * 2);
+  }
+  size_t seen = 0;
+  long long sum = 0;
+  map.for_each([&](const int& key, const int& value) {
+    EXPECT_EQ(value, key * 2);
+    seen++;
+    sum += key;
+    });
+  EXPECT_EQ(seen, 1000);
+  EXPECT_EQ(sum, 999 * 1000 / 2);
+}
+
+TEST(ConcurrentHashMapTest, ConcurrentUpsertsAreAtomic) {
+  ConcurrentHashMap<int, int> map;
+  const int threads = 8;
+  const int keys = 100;
+  const int rounds = 2000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      for (int r = 0; r < rounds; r++) {
+        map.upsert((r + t) % keys, 1, [](int& v) { v++; });
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  long long total = 0;
+  map.for_each([&](const int&, const int& value) {
+    total += value;
+    });
+  EXPECT_EQ(total, threads * rounds);
+  EXPECT_EQ(map.len(), keys);
+}
+
+TEST(ConcurrentHashMapTest, ComputeIfAbsentRunsOncePerKey) {
+  ConcurrentHashMap<int, int> map;
+  std::atomic<int> calls{ 0 };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 8; t++) {
+    workers.emplace_back([&]() {
+      for (int key = 0; key < 500; key++) {
+        int value = map.compute_if_absent(key, [&]() {
+          calls.fetch_add(1);
+          return key * 3;
+          });
+        EXPECT_EQ(value, key * 3);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(calls.load(), 500);
+}
+
+TEST(ConcurrentHashMapTest, ReadersDuringWrites) {
+  ConcurrentHashMap<int, int, 16> map;
+  std::atomic<bool> done{ false };
+  std::thread writer([&]() {
+    for (int i = 0; i < 20000; i++) {
+      map.insert(i, i);
+      if (i % 3 == 0) {
+        map.remove(i / 2);
+      }
+    }
+    done.store(true);
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        for (int i = 0; i < 100; i++) {
+          auto value = map.get(i);
+          if (value.has_value()) {
+            EXPECT_EQ(value.value(), i);
+          }
+        }
+        map.for_each([](const int& key, const int& value) {
+          EXPECT_EQ(key, value);
+          });
+        // std::shared_mutex does not prefer writers, give the writer a
+        // chance at the shard locks between rounds
+        std::this_thread::yield();
+      }
+    });
+  }
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+}
+
+TEST(ConcurrentHashMapTest, HashesEachKeyOnce) {
+  ConcurrentHashMap<HashCountedKey, int> map;
+  HashCountedKey::hashes = 0;
+  for (int i = 0; i < 1000; i++) {
+    map.insert(HashCountedKey{ i }, i);
+  }
+  EXPECT_EQ(HashCountedKey::hashes, 1000);
+  HashCountedKey::hashes = 0;
+  EXPECT_EQ(map.get(HashCountedKey{ 7 }).value(), 7);
+  EXPECT_TRUE(map.contains_key(HashCountedKey{ 8 }));
+  EXPECT_EQ(map.remove(HashCountedKey{ 9 }).value(), 9);
+  map.upsert(HashCountedKey{ 10 }, 0, [](int& value) { value++; });
+  EXPECT_EQ(map.compute_if_absent(HashCountedKey{ 2000 }, [] { return 5; }), 5);
+  EXPECT_EQ(HashCountedKey::hashes, 5);
+}
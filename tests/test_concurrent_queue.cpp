@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/concurrent_queue.h"
+
+using namespace dsun;
+
+TEST(ConcurrentQueueTest, Fifo) {
+  ConcurrentQueue<int> queue;
+  EXPECT_TRUE(queue.is_empty());
+  queue.push_back(1);
+  queue.push_back(2);
+  queue.push_back(3);
+  EXPECT_FALSE(queue.is_empty());
+  EXPECT_EQ(queue.pop_front().value(), 1);
+  EXPECT_EQ(queue.pop_front().value(), 2);
+  EXPECT_EQ(queue.pop_front().value(), 3);
+  EXPECT_FALSE(queue.pop_front().has_value());
+  EXPECT_TRUE(queue.is_empty());
+}
+
+TEST(ConcurrentQueueTest, NonTrivialValues) {
+  ConcurrentQueue<std::string> queue;
+  queue.push_back(std::string(100, 'a'));
+  queue.push_back("b");
+  EXPECT_EQ(queue.pop_front().value(), std::string(100, 'a'));
+  // the destructor releases what is still queued
+  queue.push_back("c");
+}
+
+TEST(ConcurrentQueueTest, MultiProducerMultiConsumer) {
+  ConcurrentQueue<int> queue;
+  const int producers = 4;
+  const int consumers = 4;
+  const int per_producer = 20000;
+  std::atomic<int> consumed{ 0 };
+  std::vector<std::vector<int>> seen(consumers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < per_producer; i++) {
+        queue.push_back(p * per_producer + i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; c++) {
+    threads.emplace_back([&, c]() {
+      while (consumed.load() < producers * per_producer) {
+        auto value = queue.pop_front();
+        if (value.has_value()) {
+          seen[c].push_back(value.value());
+          consumed++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> all;
+  for (auto& values : seen) {
+    // values of one producer come out in the order they went in
+    std::vector<int> last(producers, -1);
+    for (int value : values) {
+      EXPECT_LT(last[value / per_producer], value);
+      last[value / per_producer] = value;
+    }
+    all.insert(all.end(), values.begin(), values.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.size(), producers * per_producer);
+  for (int i = 0; i < producers * per_producer; i++) {
+    EXPECT_EQ(all[i], i);
+  }
+  EXPECT_TRUE(queue.is_empty());
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#define private public
+#include "../src/cuckoo_hash_map.h"
+
+using namespace dsun;
+
+namespace {
+  // every key gets the same two buckets
+  struct CollidingHash {
+    size_t operator()(uint64_t) const {
+      return 5;
+    }
+  };
+
+  // the identity, as std::hash<uint64_t> is on common standard libraries
+  struct IdentityHash {
+    size_t operator()(uint64_t key) const {
+      return static_cast<size_t>(key);
+    }
+  };
+
+  // every key of the map is in one of its two buckets or in the stash
+  template <typename Map>
+  bool keys_where_they_belong(const Map& map) {
+    size_t stored = 0;
+    for (size_t b = 0; b <= map.mask_; b++) {
+      for (size_t s = 0; s < cuckoo::kSlots; s++) {
+        if (map.buckets_[b].tags[s] == 0) {
+          continue;
+        }
+        stored++;
+        uint64_t hash = Map::hash_key(map.buckets_[b].key(s));
+        size_t home = cuckoo::home_bucket(hash, map.mask_);
+        uint8_t tag = cuckoo::tag_of(hash);
+        if (map.buckets_[b].tags[s] != tag || (b != home && b != cuckoo::alt_bucket(home, tag, map.mask_))) {
+          return false;
+        }
+      }
+    }
+    return stored + map.stash_.size() == map.len();
+  }
+}
+
+static_assert(sizeof(CuckooHashMap<uint64_t, uint32_t>::Bucket) == 64);
+static_assert(sizeof(ConcurrentCuckooHashMap<uint32_t, uint32_t>::Bucket) == 64);
+
+TEST(CuckooHashMapTest, InsertFindRemove) {
+  CuckooHashMap<std::string, int> map;
+  EXPECT_TRUE(map.insert("a", 1));
+  EXPECT_TRUE(map.insert("b", 2));
+  EXPECT_FALSE(map.insert("a", 3));
+  EXPECT_EQ(map.len(), 2);
+  EXPECT_EQ(*map.find("a"), 3);
+  EXPECT_EQ(map.get("b").value(), 2);
+  EXPECT_FALSE(map.contains_key("c"));
+  EXPECT_EQ(map.remove("a").value(), 3);
+  EXPECT_FALSE(map.remove("a").has_value());
+  EXPECT_EQ(map.len(), 1);
+  map.clear();
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_FALSE(map.contains_key("b"));
+}
+
+TEST(CuckooHashMapTest, FillsToNinetyFivePercentWithoutGrowing) {
+  CuckooHashMap<uint64_t, uint64_t> map(4096);
+  size_t capacity = map.capacity();
+  size_t target = capacity * 95 / 100;
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> keys(target);
+  for (size_t i = 0; i < target; i++) {
+    keys[i] = rng();
+    map.insert(keys[i], i);
+  }
+  EXPECT_EQ(map.capacity(), capacity);
+  EXPECT_GT(map.load_factor(), 0.94);
+  EXPECT_TRUE(keys_where_they_belong(map));
+  for (size_t i = 0; i < target; i++) {
+    ASSERT_EQ(*map.find(keys[i]), i);
+  }
+  // one more goes over the limit
+  map.insert(rng(), 0);
+  EXPECT_EQ(map.capacity(), capacity * 2);
+  EXPECT_TRUE(keys_where_they_belong(map));
+}
+
+TEST(CuckooHashMapTest, ChurnKeepsEveryKeyInItsBuckets) {
+  CuckooHashMap<uint64_t, uint64_t> map;
+  std::mt19937_64 rng(2);
+  std::vector<uint64_t> live;
+  for (int round = 0; round < 20000; round++) {
+    if (live.empty() || rng() % 3 != 0) {
+      uint64_t key = rng();
+      map.insert(key, key * 3);
+      live.push_back(key);
+    }
+    else {
+      size_t at = rng() % live.size();
+      ASSERT_EQ(map.remove(live[at]).value(), live[at] * 3);
+      live[at] = live.back();
+      live.pop_back();
+    }
+  }
+  EXPECT_EQ(map.len(), live.size());
+  EXPECT_TRUE(keys_where_they_belong(map));
+  for (uint64_t key : live) {
+    ASSERT_EQ(*map.find(key), key * 3);
+  }
+  size_t visited = 0;
+  map.for_each([&](const uint64_t& key, const uint64_t& value) {
+    EXPECT_EQ(value, key * 3);
+    visited++;
+    });
+  EXPECT_EQ(visited, live.size());
+}
+
+TEST(CuckooHashMapTest, EveryKeyHasTwoBuckets) {
+  for (size_t mask : { size_t(1), size_t(3), size_t(15), size_t(1023) }) {
+    for (unsigned tag = 1; tag < 256; tag++) {
+      for (size_t bucket : { size_t(0), mask }) {
+        size_t alt = cuckoo::alt_bucket(bucket, static_cast<uint8_t>(tag), mask);
+        ASSERT_NE(alt, bucket) << mask << " " << tag;
+        ASSERT_LE(alt, mask);
+        ASSERT_EQ(cuckoo::alt_bucket(alt, static_cast<uint8_t>(tag), mask), bucket);
+      }
+    }
+  }
+}
+
+TEST(CuckooHashMapTest, IdentityHashedKeysSpread) {
+  CuckooHashMap<uint64_t, uint64_t, IdentityHash> map(4096);
+  size_t capacity = map.capacity();
+  size_t target = capacity * 95 / 100;
+  // small consecutive keys, whose raw hashes have an empty top byte
+  for (uint64_t i = 0; i < target; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.capacity(), capacity);
+  EXPECT_TRUE(keys_where_they_belong(map));
+  for (uint64_t i = 0; i < target; i++) {
+    ASSERT_EQ(*map.find(i), i);
+  }
+}
+
+TEST(CuckooHashMapTest, CollidingKeysGoToTheStash) {
+  CuckooHashMap<uint64_t, uint64_t, CollidingHash> map;
+  for (uint64_t i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  // two buckets' worth in the table, the rest stashed. the table only
+  // grows while at least half full, since more buckets cannot spread
+  // these keys
+  EXPECT_EQ(map.stash_.size(), 100 - 2 * cuckoo::kSlots);
+  EXPECT_GE(map.load_factor(), 0.25);
+  for (uint64_t i = 0; i < 100; i++) {
+    ASSERT_EQ(*map.find(i), i);
+  }
+  // a remove from a bucket pulls a stashed key in
+  size_t home = cuckoo::home_bucket(decltype(map)::hash_key(0), map.mask_);
+  map.remove(map.buckets_[home].key(0));
+  EXPECT_EQ(map.stash_.size(), 100 - 2 * cuckoo::kSlots - 1);
+  EXPECT_TRUE(keys_where_they_belong(map));
+}
+
+static_assert(std::is_nothrow_move_constructible_v<CuckooHashMap<std::string, int>>);
+static_assert(std::is_nothrow_move_assignable_v<CuckooHashMap<std::string, int>>);
+
+TEST(CuckooHashMapTest, MoveLeavesSourceUsable) {
+  CuckooHashMap<std::string, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(std::to_string(i), i);
+  }
+  CuckooHashMap<std::string, int> moved(std::move(map));
+  EXPECT_EQ(moved.len(), 100);
+  EXPECT_EQ(*moved.find("42"), 42);
+  // the source keeps no buckets, and lookups on it still work
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_EQ(map.capacity(), 0);
+  EXPECT_EQ(map.find("42"), nullptr);
+  EXPECT_FALSE(map.remove("42").has_value());
+  map.clear();
+  map.insert("one", 1);
+  EXPECT_EQ(*map.find("one"), 1);
+  EXPECT_TRUE(keys_where_they_belong(map));
+
+  // a vector of maps moves them when it reallocates
+  std::vector<CuckooHashMap<std::string, int>> maps;
+  for (int i = 0; i < 10; i++) {
+    maps.emplace_back();
+    maps.back().insert("key", i);
+  }
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(*maps[i].find("key"), i);
+  }
+}
+
+TEST(ConcurrentCuckooHashMapTest, InsertGetRemove) {
+  ConcurrentCuckooHashMap<uint64_t, uint64_t> map;
+  for (uint64_t i = 0; i < 10000; i++) {
+    EXPECT_TRUE(map.insert(i, i * 2));
+  }
+  EXPECT_FALSE(map.insert(7, 1));
+  EXPECT_EQ(map.len(), 10000);
+  EXPECT_EQ(map.get(7).value(), 1);
+  for (uint64_t i = 0; i < 10000; i += 2) {
+    EXPECT_TRUE(map.remove(i).has_value());
+  }
+  EXPECT_EQ(map.len(), 5000);
+  for (uint64_t i = 1; i < 10000; i += 2) {
+    ASSERT_EQ(map.get(i).value(), i == 7 ? 1 : i * 2);
+  }
+  EXPECT_FALSE(map.contains_key(0));
+}
+
+TEST(ConcurrentCuckooHashMapTest, CollidingKeysUseAGrowingStash) {
+  ConcurrentCuckooHashMap<uint64_t, uint64_t, CollidingHash> map;
+  for (uint64_t i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  for (uint64_t i = 0; i < 100; i++) {
+    ASSERT_EQ(map.get(i).value(), i);
+  }
+  for (uint64_t i = 0; i < 100; i += 3) {
+    ASSERT_EQ(map.remove(i).value(), i);
+  }
+  for (uint64_t i = 0; i < 100; i++) {
+    ASSERT_EQ(map.contains_key(i), i % 3 != 0);
+  }
+}
+
+TEST(ConcurrentCuckooHashMapTest, ReadersNeverMissStableKeys) {
+  ConcurrentCuckooHashMap<uint64_t, uint64_t> map;
+  // stable keys are never written again, so every read must find them
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.insert(i, i + 1);
+  }
+  std::atomic<bool> done = false;
+  std::atomic<size_t> failures = 0;
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&, t]() {
+      std::mt19937_64 rng(t);
+      while (!done.load()) {
+        uint64_t key = rng() % 1000;
+        if (map.get(key) != key + 1) {
+          failures++;
+        }
+        // churned keys always carry their own value
+        uint64_t churned = 1000 + rng() % 20000;
+        auto value = map.get(churned);
+        if (value.has_value() && value.value() != churned * 7) {
+          failures++;
+        }
+      }
+      });
+  }
+  std::thread writer([&]() {
+    std::mt19937_64 rng(9);
+    for (int round = 0; round < 60000; round++) {
+      uint64_t key = 1000 + rng() % 20000;
+      if (rng() % 2 == 0) {
+        map.insert(key, key * 7);
+      }
+      else {
+        map.remove(key);
+      }
+    }
+    done = true;
+    });
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+  epoch::collect();
+}
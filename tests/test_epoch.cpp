@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/epoch.h"
+
+using namespace dsun;
+
+namespace {
+  std::atomic<int> freed{ 0 };
+
+  struct Tracked {
+    ~Tracked() {
+      freed++;
+    }
+  };
+}
+
+TEST(EpochTest, RetiredPointerIsFreedAfterCollect) {
+  freed = 0;
+  {
+    auto guard = epoch::pin();
+    epoch::retire(new Tracked());
+  }
+  epoch::collect();
+  EXPECT_EQ(freed.load(), 1);
+  EXPECT_EQ(epoch::pending(), 0);
+}
+
+TEST(EpochTest, PinnedThreadBlocksReclamation) {
+  freed = 0;
+  std::atomic<bool> pinned{ false };
+  std::atomic<bool> release{ false };
+  std::thread reader([&]() {
+    auto guard = epoch::pin();
+    pinned = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!pinned) {
+    std::this_thread::yield();
+  }
+  epoch::retire(new Tracked());
+  epoch::collect();
+  EXPECT_EQ(freed.load(), 0);
+
+  release = true;
+  reader.join();
+  epoch::collect();
+  EXPECT_EQ(freed.load(), 1);
+}
+
+TEST(EpochTest, NestedGuards) {
+  freed = 0;
+  {
+    auto outer = epoch::pin();
+    {
+      auto inner = epoch::pin();
+    }
+    epoch::retire(new Tracked());
+    epoch::collect();
+    EXPECT_EQ(freed.load(), 0);
+  }
+  epoch::collect();
+  EXPECT_EQ(freed.load(), 1);
+}
+
+TEST(EpochTest, ExitedThreadRetiredListIsAdopted) {
+  freed = 0;
+  std::thread worker([]() {
+    auto guard = epoch::pin();
+    epoch::retire(new Tracked());
+  });
+  worker.join();
+  epoch::collect();
+  EXPECT_EQ(freed.load(), 1);
+}
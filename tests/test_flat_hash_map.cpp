@@ -1,8 +1,75 @@
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #define private public
 #include "../src/swiss_table.h"
 using namespace SwissTables;
 
+struct Cell {
+  int32_t row;
+  int32_t column;
+  bool operator==(const Cell&) const = default;
+};
+DERIVE_HASH(Cell)
+HASH_CLASS_ATTRIBUTE(row)
+HASH_CLASS_ATTRIBUTE(column)
+END_DERIVE_HASH()
+
+// the identity, as std::hash<int> is on common standard libraries
+struct IdentityHash {
+  size_t operator()(int key) const {
+    return static_cast<size_t>(key);
+  }
+};
+
+// counts live instances, and has no default constructor
+struct Tracked {
+  static inline int live = 0;
+  int id;
+  explicit Tracked(int id) : id(id) {
+    live++;
+  }
+  Tracked(const Tracked& other) : id(other.id) {
+    live++;
+  }
+  Tracked(Tracked&& other) noexcept : id(other.id) {
+    live++;
+  }
+  Tracked& operator=(const Tracked&) = default;
+  Tracked& operator=(Tracked&&) = default;
+  ~Tracked() {
+    live--;
+  }
+};
+
+template <typename Map>
+concept Insertable = requires(Map& map) {
+  map.insert(1, 1);
+};
+
+// counts default constructions
+struct Defaulted {
+  static inline int made = 0;
+  int value = 0;
+  Defaulted() {
+    made++;
+  }
+};
+
+struct SeededHash {
+  using is_avalanching = void;
+  uint64_t seed = 0;
+  size_t operator()(uint64_t key) const {
+    return static_cast<size_t>(dsun::hash_combine(seed, key));
+  }
+};
+
 
 TEST(FlatHashMap, Iter) {
   auto map = FlatHashMap<int, int>(10);
@@ -10,9 +77,728 @@ TEST(FlatHashMap, Iter) {
   map.insert(2, 2);
   map.insert(3, 3);
   map.insert(4, 4);
-  auto count = 1;
+  // slots follow the hash, not insertion order
+  std::vector<int> values;
+  for (auto& entry : map) {
+    EXPECT_EQ(entry.key, entry.value);
+    values.push_back(entry.value);
+  }
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values, std::vector<int>({ 1, 2, 3, 4 }));
+}
+
+TEST(FlatHashMap, Entry) {
+  auto map = FlatHashMap<int, int>(64);
+  for (int round = 0; round < 3; round++) {
+    for (int i = 1; i <= 20; i++) {
+      map.entry(i).and_modify([](int& v) { v++; }).or_insert(1);
+    }
+  }
+  EXPECT_EQ(map.len(), 20);
+  for (int i = 1; i <= 20; i++) {
+    EXPECT_EQ(map.entry(i).or_insert(0), 3);
+  }
+  EXPECT_FALSE(map.insert(5, 0));
+
+  auto entry = map.entry(30);
+  EXPECT_FALSE(entry.is_occupied());
+  int calls = 0;
+  entry.or_insert_with([&]() {
+    calls++;
+    return 7;
+  }) += 1;
+  EXPECT_TRUE(entry.is_occupied());
+  EXPECT_EQ(map.entry(30).or_insert_with([&]() {
+    calls++;
+    return 0;
+  }), 8);
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(map.len(), 21);
+}
+
+namespace {
+  // counts its copies
+  struct CountedKey {
+    static inline int copies = 0;
+    int value;
+    explicit CountedKey(int value) : value(value) {}
+    CountedKey(const CountedKey& other) : value(other.value) {
+      copies++;
+    }
+    CountedKey(CountedKey&&) noexcept = default;
+    CountedKey& operator=(const CountedKey&) = default;
+    CountedKey& operator=(CountedKey&&) noexcept = default;
+    bool operator==(const CountedKey& other) const {
+      return value == other.value;
+    }
+  };
+
+  struct CountedKeyHash {
+    size_t operator()(const CountedKey& key) const {
+      return std::hash<int>{}(key.value);
+    }
+  };
+}
+
+TEST(FlatHashMap, EntryCopiesTheKeyOnlyOnAMiss) {
+  FlatHashMap<CountedKey, int, CountedKeyHash> map;
+  CountedKey key(1);
+  CountedKey::copies = 0;
+  map[key]++;
+  EXPECT_EQ(CountedKey::copies, 1);
+  for (int i = 0; i < 10; i++) {
+    map[key]++;
+    map.entry(key).and_modify([](int& value) { value++; });
+  }
+  EXPECT_EQ(CountedKey::copies, 1);
+  EXPECT_EQ(map.entry(key).key().value, 1);
+  EXPECT_EQ(*map.find(key), 21);
+  // an rvalue key is moved in on a miss
+  map[CountedKey(2)] = 5;
+  map.entry(CountedKey(3)).or_insert(6);
+  EXPECT_EQ(CountedKey::copies, 1);
+  EXPECT_EQ(*map.find(CountedKey(2)), 5);
+  EXPECT_EQ(*map.find(CountedKey(3)), 6);
+}
+
+TEST(FlatHashMap, GetMany) {
+  auto map = FlatHashMap<int, int>(256);
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, -i);
+  }
+  std::vector<int> keys;
+  for (int i = 50; i < 150; i++) {
+    keys.push_back(i);
+  }
+  std::vector<const int*> values(keys.size());
+  map.get_many(keys, values);
+  bool present[100];
+  EXPECT_EQ(map.contains_many(keys, present), 50);
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (keys[i] < 100) {
+      EXPECT_TRUE(present[i]);
+      EXPECT_EQ(*values[i], -keys[i]);
+    }
+    else {
+      EXPECT_FALSE(present[i]);
+      EXPECT_EQ(values[i], nullptr);
+    }
+  }
+}
+
+TEST(FlatHashMap, GroupProbingFindsEveryKey) {
+  auto map = FlatHashMap<uint64_t, uint64_t>(1000);
+  EXPECT_EQ(map.capacity_, 1024);
+  // fill up to the 7/8 growth limit, probe sequences get long and wrap around
+  for (uint64_t i = 0; i < 896; i++) {
+    EXPECT_TRUE(map.insert(i * 31, i));
+  }
+  EXPECT_EQ(map.len(), 896);
+  EXPECT_EQ(map.capacity_, 1024);
+  EXPECT_EQ(map.growth_left_, 0);
+  for (uint64_t i = 0; i < 896; i++) {
+    ASSERT_NE(map.find(i * 31), nullptr) << i;
+    EXPECT_EQ(*map.find(i * 31), i);
+  }
+  EXPECT_EQ(map.find(1), nullptr);
+  // every full slot's ctrl byte holds the 7 bit H2
+  size_t full = 0;
+  for (size_t i = 0; i < map.capacity_; i++) {
+    if (IsFull(map.ctrl_[i])) {
+      EXPECT_EQ(static_cast<uint8_t>(map.ctrl_[i]), H2(map.hash_key(map.slots_[i].key)));
+      full++;
+    }
+  }
+  EXPECT_EQ(full, 896);
+}
+
+TEST(FlatHashMap, GrowsAtSevenEighths) {
+  auto map = FlatHashMap<int, int>();
+  EXPECT_EQ(map.capacity_, 16);
+  for (int i = 0; i < 14; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.capacity_, 16);
+  map.insert(14, 14);
+  EXPECT_EQ(map.capacity_, 32);
+  for (int i = 15; i < 100000; i++) {
+    EXPECT_TRUE(map.insert(i, i));
+  }
+  EXPECT_EQ(map.len(), 100000);
+  EXPECT_EQ(map.capacity_, 131072);
+  for (int i = 0; i < 100000; i++) {
+    ASSERT_NE(map.find(i), nullptr) << i;
+    EXPECT_EQ(*map.find(i), i);
+  }
+  EXPECT_FALSE(map.insert(5, 0));
+}
+
+TEST(FlatHashMap, EraseLeavesTombstones) {
+  auto map = FlatHashMap<int, std::string>(64);
+  for (int i = 0; i < 56; i++) {
+    map.insert(i, std::to_string(i));
+  }
+  for (int i = 0; i < 56; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  EXPECT_FALSE(map.erase(0));
+  EXPECT_FALSE(map.erase(1000));
+  EXPECT_EQ(map.len(), 28);
+  // erased slots of groups that were full stay tombstones, those of
+  // groups with an empty slot went back to empty
+  size_t deleted = 0;
+  for (size_t base = 0; base < map.capacity_; base += map.kGroupWidth) {
+    size_t group_deleted = 0;
+    size_t group_empty = 0;
+    for (size_t i = base; i < base + map.kGroupWidth; i++) {
+      group_deleted += IsDeleted(map.ctrl_[i]);
+      group_empty += IsEmpty(map.ctrl_[i]);
+    }
+    EXPECT_TRUE(group_deleted == 0 || group_empty == 0);
+    deleted += group_deleted;
+  }
+  EXPECT_GT(deleted, 0);
+  EXPECT_EQ(map.growth_left_ + map.len() + deleted, 56);
+  for (int i = 0; i < 56; i++) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(map.find(i), nullptr);
+    }
+    else {
+      ASSERT_NE(map.find(i), nullptr);
+      EXPECT_EQ(*map.find(i), std::to_string(i));
+    }
+  }
+  size_t seen = 0;
+  for (auto& entry : map) {
+    EXPECT_EQ(entry.key % 2, 1);
+    seen++;
+  }
+  EXPECT_EQ(seen, 28);
+
+  // an insert reuses a tombstone on its probe path
+  EXPECT_TRUE(map.insert(0, "zero"));
+  EXPECT_EQ(*map.find(0), "zero");
+  EXPECT_EQ(map.len(), 29);
+}
+
+TEST(FlatHashMap, EraseInSparseGroupEmptiesSlot) {
+  auto map = FlatHashMap<int, int>(1024);
+  size_t growth_left = map.growth_left_;
+  map.insert(1, 1);
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_EQ(map.growth_left_, growth_left);
+  for (size_t i = 0; i < map.capacity_; i++) {
+    EXPECT_TRUE(IsEmpty(map.ctrl_[i]));
+  }
+}
+
+TEST(FlatHashMap, ChurnRehashesInPlace) {
+  auto map = FlatHashMap<int, int>(1024);
+  // a steady live set of 500 keys with inserts and erases rotating through
+  // it: the tombstones are dropped in place and the table never grows
+  for (int i = 0; i < 500; i++) {
+    map.insert(i, i);
+  }
+  const int* slots_before = &map.slots_[0].value;
+  for (int i = 500; i < 20000; i++) {
+    EXPECT_TRUE(map.erase(i - 500));
+    EXPECT_TRUE(map.insert(i, i));
+  }
+  EXPECT_EQ(map.capacity_, 1024);
+  EXPECT_EQ(&map.slots_[0].value, slots_before);
+  EXPECT_EQ(map.len(), 500);
+  for (int i = 0; i < 20000; i++) {
+    if (i < 19500) {
+      EXPECT_EQ(map.find(i), nullptr) << i;
+    }
+    else {
+      ASSERT_NE(map.find(i), nullptr) << i;
+      EXPECT_EQ(*map.find(i), i);
+    }
+  }
+}
+
+TEST(FlatHashMap, DropTombstonesKeepsEveryKey) {
+  auto map = FlatHashMap<int, int>(256);
+  for (int i = 0; i < 224; i++) {
+    map.insert(i * 13, i);
+  }
+  for (int i = 0; i < 224; i += 3) {
+    map.erase(i * 13);
+  }
+  map.drop_tombstones();
+  size_t full = 0;
+  for (size_t i = 0; i < map.capacity_; i++) {
+    EXPECT_FALSE(IsDeleted(map.ctrl_[i]));
+    full += IsFull(map.ctrl_[i]);
+  }
+  EXPECT_EQ(full, map.len());
+  EXPECT_EQ(map.growth_left_, 224 - map.len());
+  for (int i = 0; i < 224; i++) {
+    if (i % 3 == 0) {
+      EXPECT_EQ(map.find(i * 13), nullptr);
+    }
+    else {
+      ASSERT_NE(map.find(i * 13), nullptr) << i;
+      EXPECT_EQ(*map.find(i * 13), i);
+    }
+  }
+}
+
+TEST(FlatHashMap, IndexOperatorAndMutableFind) {
+  auto map = FlatHashMap<std::string, int>();
+  for (const char* word : { "a", "b", "a", "c", "a", "b" }) {
+    map[word]++;
+  }
+  EXPECT_EQ(map.len(), 3);
+  EXPECT_EQ(map["a"], 3);
+  EXPECT_EQ(map["b"], 2);
+  *map.find("c") = 10;
+  EXPECT_EQ(*std::as_const(map).find("c"), 10);
+  EXPECT_EQ(map.find("d"), nullptr);
+  // growth moves the strings and keeps them intact
+  for (int i = 0; i < 1000; i++) {
+    map[std::to_string(i)] = i;
+  }
+  EXPECT_EQ(map.len(), 1003);
+  EXPECT_EQ(map["a"], 3);
+  EXPECT_EQ(map["999"], 999);
+
+  // a hit builds no value
+  auto values = FlatHashMap<int, Defaulted>();
+  values[1].value = 5;
+  Defaulted::made = 0;
+  EXPECT_EQ(values[1].value, 5);
+  EXPECT_EQ(Defaulted::made, 0);
+  values[2];
+  EXPECT_EQ(Defaulted::made, 1);
+}
+
+TEST(FlatHashMap, SaveLoadAndMap) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_flat_hash_map_test.bin").string();
+  auto map = FlatHashMap<uint64_t, uint64_t>(4096);
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.insert(i * 7, i);
+  }
+  ASSERT_TRUE(map.save(path.c_str()));
+
+  auto loaded = FlatHashMap<uint64_t, uint64_t>::load(path.c_str());
+  ASSERT_TRUE(loaded.has_value());
+  auto mapped = FlatHashMap<uint64_t, uint64_t>::open_mapped(path.c_str());
+  ASSERT_TRUE(mapped.has_value());
+  static_assert(std::is_same_v<decltype(mapped)::value_type, FlatHashMapView<uint64_t, uint64_t>>);
+  // the mapping is read-only, and so is the view
+  static_assert(Insertable<FlatHashMap<uint64_t, uint64_t>> && !Insertable<FlatHashMapView<uint64_t, uint64_t>>);
+
+  // both probe exactly like the table that was saved
+  auto probes_like_saved = [&](const auto& copy) {
+    EXPECT_EQ(copy.len(), map.len());
+    for (uint64_t key = 0; key < 7000; key++) {
+      const uint64_t* expected = map.find(key);
+      const uint64_t* actual = copy.find(key);
+      ASSERT_EQ(actual == nullptr, expected == nullptr) << key;
+      if (expected != nullptr) {
+        EXPECT_EQ(*actual, *expected);
+      }
+    }
+  };
+  probes_like_saved(*loaded);
+  probes_like_saved(*mapped);
+  EXPECT_TRUE(mapped->contains(7));
+  EXPECT_EQ(mapped->stats().bytes_allocated, 0);
+  size_t seen = 0;
+  for (auto& entry : *mapped) {
+    EXPECT_EQ(entry.key, entry.value * 7);
+    seen++;
+  }
+  size_t expected_seen = 0;
   for (auto& entry : map) {
-    EXPECT_EQ(count, entry.value);
-    count++;
+    (void)entry;
+    expected_seen++;
+  }
+  EXPECT_EQ(seen, expected_seen);
+
+  // a loaded table is an ordinary heap table
+  loaded->insert(1, 1);
+  EXPECT_EQ(*loaded->find(1), 1);
+
+  EXPECT_FALSE((FlatHashMap<uint64_t, uint32_t>::open_mapped(path.c_str()).has_value()));
+  EXPECT_FALSE((FlatHashMap<uint64_t, uint64_t>::load("/nonexistent/dsun.bin").has_value()));
+  std::filesystem::remove(path);
+}
+
+TEST(FlatHashMap, StringAndStructKeys) {
+  auto words = FlatHashMap<std::string_view, int>();
+  std::string text = "the quick fox and the lazy dog and the cat";
+  for (size_t start = 0; start < text.size();) {
+    size_t end = std::min(text.find(' ', start), text.size());
+    words[std::string_view(text).substr(start, end - start)]++;
+    start = end + 1;
+  }
+  EXPECT_EQ(words.len(), 7);
+  EXPECT_EQ(words["the"], 3);
+  EXPECT_EQ(words["and"], 2);
+
+  auto grid = FlatHashMap<Cell, int>();
+  for (int32_t row = 0; row < 100; row++) {
+    for (int32_t column = 0; column < 100; column++) {
+      grid.insert({ row, column }, row * 100 + column);
+    }
+  }
+  EXPECT_EQ(grid.len(), 10000);
+  EXPECT_EQ(*grid.find({ 42, 7 }), 4207);
+  EXPECT_EQ(grid.find({ 100, 0 }), nullptr);
+}
+
+TEST(FlatHashMap, WeakHasherIsMixed) {
+  auto map = FlatHashMap<int, int, IdentityHash>(1024);
+  for (int i = 0; i < 256; i++) {
+    map.insert(i, i);
+  }
+  // raw identity hashes would put all of 0..255 in group 0 and its
+  // neighbours; mixed ones reach most of the 64 groups
+  size_t groups_used = 0;
+  for (size_t base = 0; base < map.capacity_; base += map.kGroupWidth) {
+    bool used = false;
+    for (size_t i = base; i < base + map.kGroupWidth; i++) {
+      used |= IsFull(map.ctrl_[i]);
+    }
+    groups_used += used;
+  }
+  EXPECT_GT(groups_used, 48);
+  for (int i = 0; i < 256; i++) {
+    ASSERT_NE(map.find(i), nullptr);
+    EXPECT_EQ(*map.find(i), i);
+  }
+}
+
+TEST(FlatHashMap, StatefulHasher) {
+  auto a = FlatHashMap<uint64_t, int, SeededHash>(64, SeededHash{ 1 });
+  auto b = FlatHashMap<uint64_t, int, SeededHash>(64, SeededHash{ 2 });
+  for (uint64_t i = 0; i < 40; i++) {
+    a.insert(i, 1);
+    b.insert(i, 2);
+  }
+  // same keys, different seeds: the slots differ but lookups agree
+  bool same_layout = true;
+  for (size_t i = 0; i < a.capacity_; i++) {
+    same_layout &= a.ctrl_[i] == b.ctrl_[i];
+  }
+  EXPECT_FALSE(same_layout);
+  auto moved = std::move(b);
+  for (uint64_t i = 0; i < 40; i++) {
+    EXPECT_EQ(*a.find(i), 1);
+    EXPECT_EQ(*moved.find(i), 2);
+  }
+
+  // a file is only read back with the seed it was written with
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_flat_hash_map_seed_test.bin").string();
+  ASSERT_TRUE(a.save(path.c_str()));
+  using Map = FlatHashMap<uint64_t, int, SeededHash>;
+  EXPECT_TRUE(Map::load(path.c_str(), SeededHash{ 1 }).has_value());
+  EXPECT_FALSE(Map::load(path.c_str(), SeededHash{ 2 }).has_value());
+  EXPECT_FALSE(Map::open_mapped(path.c_str(), SeededHash{ 2 }).has_value());
+  EXPECT_FALSE((FlatHashMap<uint64_t, int>::load(path.c_str()).has_value()));
+  std::filesystem::remove(path);
+}
+
+template <typename G>
+class FlatHashMapGroupTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    if (!G::supported()) {
+      GTEST_SKIP() << "cpu lacks the instruction set";
+    }
+  }
+};
+
+#if DSUN_SWISS_X86
+using GroupTypes = ::testing::Types<GroupPortable, GroupSse2, GroupAvx2, GroupAvx512>;
+#else
+using GroupTypes = ::testing::Types<GroupPortable>;
+#endif
+TYPED_TEST_SUITE(FlatHashMapGroupTest, GroupTypes);
+
+TYPED_TEST(FlatHashMapGroupTest, MatchesAgreeWithScalar) {
+  using Group = TypeParam;
+  std::mt19937 rng(3);
+  ctrl_t ctrl[Group::kWidth];
+  for (int round = 0; round < 1000; round++) {
+    for (auto& byte : ctrl) {
+      uint32_t pick = rng() % 4;
+      byte = pick == 0 ? ctrl_t::Empty : pick == 1 ? ctrl_t::Deleted : static_cast<ctrl_t>(rng() % 8);
+    }
+    auto group = Group::load(ctrl);
+    int8_t h2 = static_cast<int8_t>(rng() % 8);
+    uint64_t matched = 0;
+    for (uint32_t i : group.match_byte(h2)) {
+      matched |= uint64_t(1) << i;
+    }
+    uint64_t empty = 0;
+    for (uint32_t i : group.match_empty()) {
+      empty |= uint64_t(1) << i;
+    }
+    uint64_t free = 0;
+    for (uint32_t i : group.match_empty_or_deleted()) {
+      free |= uint64_t(1) << i;
+    }
+    for (size_t i = 0; i < Group::kWidth; i++) {
+      // match_byte may report a false positive, never miss a slot
+      if (ctrl[i] == static_cast<ctrl_t>(h2)) {
+        EXPECT_TRUE(matched >> i & 1);
+      }
+      EXPECT_EQ(empty >> i & 1, IsEmpty(ctrl[i]));
+      EXPECT_EQ(free >> i & 1, !IsFull(ctrl[i]));
+    }
+  }
+}
+
+TYPED_TEST(FlatHashMapGroupTest, InsertEraseAndGrow) {
+  auto map = FlatHashMap<uint64_t, uint64_t, dsun::Hash<uint64_t>, TypeParam>();
+  EXPECT_EQ(map.capacity_, std::max<size_t>(16, TypeParam::kWidth));
+  for (uint64_t i = 0; i < 20000; i++) {
+    EXPECT_TRUE(map.insert(i, i * 2));
+  }
+  for (uint64_t i = 0; i < 20000; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  for (uint64_t i = 20000; i < 30000; i++) {
+    EXPECT_TRUE(map.insert(i, i * 2));
+  }
+  EXPECT_EQ(map.len(), 20000);
+  for (uint64_t i = 0; i < 30000; i++) {
+    const uint64_t* value = map.find(i);
+    if (i < 20000 && i % 2 == 0) {
+      EXPECT_EQ(value, nullptr) << i;
+    }
+    else {
+      ASSERT_NE(value, nullptr) << i;
+      EXPECT_EQ(*value, i * 2);
+    }
+  }
+}
+
+TEST(FlatHashMap, WidestGroupDispatch) {
+  size_t width = with_widest_group([](auto group) {
+    using Group = typename decltype(group)::type;
+    EXPECT_TRUE(Group::supported());
+    return Group::kWidth;
+  });
+  EXPECT_GE(width, DSUN_SWISS_X86 ? 16u : 8u);
+}
+
+TEST(FlatHashSet, InsertEraseContains) {
+  auto set = FlatHashSet<std::string>();
+  EXPECT_TRUE(set.insert("apple"));
+  EXPECT_TRUE(set.insert("pear"));
+  EXPECT_FALSE(set.insert("apple"));
+  EXPECT_EQ(set.len(), 2);
+  EXPECT_TRUE(set.contains("pear"));
+  EXPECT_TRUE(set.erase("pear"));
+  EXPECT_FALSE(set.contains("pear"));
+  for (int i = 0; i < 1000; i++) {
+    set.insert(std::to_string(i));
+  }
+  EXPECT_EQ(set.len(), 1001);
+  std::vector<std::string> keys;
+  for (const std::string& key : set) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+  EXPECT_EQ(keys.size(), 1001);
+  EXPECT_EQ(keys.back(), "apple");
+  // slots are the keys alone, no value rides along
+  EXPECT_EQ(sizeof(*set.slots_), sizeof(std::string));
+}
+
+TEST(FlatNodeHashMap, ReferencesSurviveRehash) {
+  auto map = FlatNodeHashMap<int, std::string>();
+  std::string& first = map[0];
+  first = "zero";
+  const int* key = &map.begin()->key;
+  size_t capacity = map.capacity_;
+  for (int i = 1; i < 10000; i++) {
+    map[i] = std::to_string(i);
+  }
+  EXPECT_GT(map.capacity_, capacity);
+  // the node did not move, only the pointer to it did
+  EXPECT_EQ(&first, map.find(0));
+  EXPECT_EQ(first, "zero");
+  EXPECT_EQ(*key, 0);
+
+  for (int i = 0; i < 10000; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  EXPECT_EQ(map.len(), 5000);
+  EXPECT_EQ(*map.find(9999), "9999");
+  EXPECT_EQ(map.find(0), nullptr);
+  EXPECT_FALSE(map.insert(1, "one"));
+  map.entry(1).and_modify([](std::string& value) { value += "!"; });
+  EXPECT_EQ(*map.find(1), "1!");
+  size_t seen = 0;
+  for (auto& node : map) {
+    EXPECT_EQ(node.key % 2, 1);
+    seen++;
+  }
+  EXPECT_EQ(seen, 5000);
+}
+
+TEST(FlatHashMap, SingleAllocationWithSentinel) {
+  auto map = FlatHashMap<uint64_t, std::string>(100);
+  EXPECT_EQ(map.capacity_, 128);
+  EXPECT_EQ(map.ctrl_[map.capacity_], ctrl_t::Sentinel);
+  auto* ctrl = reinterpret_cast<unsigned char*>(map.ctrl_);
+  auto* slots = reinterpret_cast<unsigned char*>(map.slots_);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ctrl) % map.kGroupWidth, 0);
+  EXPECT_GT(slots, ctrl + map.capacity_);
+  EXPECT_LT(slots, ctrl + map.capacity_ + 1 + alignof(std::string));
+  EXPECT_EQ(map.begin(), map.end());
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.insert(i, std::to_string(i));
+  }
+  EXPECT_EQ(map.ctrl_[map.capacity_], ctrl_t::Sentinel);
+  size_t seen = 0;
+  for (auto& entry : map) {
+    EXPECT_EQ(entry.value, std::to_string(entry.key));
+    seen++;
+  }
+  EXPECT_EQ(seen, 1000);
+}
+
+TEST(FlatHashMap, ElementsLiveOnlyInFullSlots) {
+  Tracked::live = 0;
+  {
+    auto map = FlatHashMap<int, Tracked>(1024);
+    // nothing is constructed up front
+    EXPECT_EQ(Tracked::live, 0);
+    for (int i = 0; i < 5000; i++) {
+      map.insert(i, Tracked(i));
+    }
+    EXPECT_EQ(Tracked::live, 5000);
+    for (int i = 0; i < 5000; i += 2) {
+      map.erase(i);
+    }
+    EXPECT_EQ(Tracked::live, 2500);
+    // churn through in-place rehashes
+    for (int i = 5000; i < 20000; i++) {
+      map.erase(i - 5000 + 1);
+      map.insert(i, Tracked(i));
+    }
+    EXPECT_EQ(static_cast<size_t>(Tracked::live), map.len());
+    EXPECT_EQ(map.find(19999)->id, 19999);
+    auto moved = std::move(map);
+    EXPECT_EQ(static_cast<size_t>(Tracked::live), moved.len());
+  }
+  EXPECT_EQ(Tracked::live, 0);
+
+  {
+    auto set = FlatHashSet<std::string>();
+    auto nodes = FlatNodeHashMap<int, Tracked>();
+    for (int i = 0; i < 100; i++) {
+      set.insert(std::to_string(i));
+      nodes.insert(i, Tracked(i));
+    }
+    EXPECT_EQ(Tracked::live, 100);
+  }
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(FlatHashMap, MovedFromTablesStayUsable) {
+  auto map = FlatHashMap<int, int>();
+  auto nodes = FlatNodeHashMap<int, int>();
+  auto set = FlatHashSet<int>();
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i);
+    nodes.insert(i, i);
+    set.insert(i);
+  }
+  auto map_moved = std::move(map);
+  auto nodes_moved = std::move(nodes);
+  auto set_moved = std::move(set);
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_EQ(map.find(1), nullptr);
+  EXPECT_FALSE(nodes.erase(1));
+  EXPECT_FALSE(set.contains(1));
+  EXPECT_EQ(map.begin(), map.end());
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, -i);
+    nodes[i] = -i;
+    set.insert(i);
+  }
+  EXPECT_EQ(map.len(), 100);
+  EXPECT_EQ(*map.find(99), -99);
+  EXPECT_EQ(*nodes.find(50), -50);
+  EXPECT_TRUE(set.contains(7));
+  EXPECT_EQ(*map_moved.find(99), 99);
+  EXPECT_EQ(nodes_moved.len(), 100);
+  EXPECT_EQ(set_moved.len(), 100);
+}
+
+TEST(FlatHashMap, BulkBuildMatchesInsert) {
+  std::mt19937_64 rng(5);
+  for (size_t n : { size_t(0), size_t(10), size_t(1000), size_t(100000) }) {
+    std::vector<std::pair<uint64_t, uint64_t>> items(n);
+    for (auto& item : items) {
+      item = { rng(), rng() };
+    }
+    for (size_t threads : { 1, 3, 8 }) {
+      auto map = FlatHashMap<uint64_t, uint64_t>::bulk_build(items, threads);
+      EXPECT_EQ(map.len(), n);
+      EXPECT_EQ(map.growth_left_ + n, map.growth_limit(map.capacity_));
+      for (auto& [key, value] : items) {
+        ASSERT_NE(map.find(key), nullptr);
+        EXPECT_EQ(*map.find(key), value);
+      }
+      EXPECT_EQ(map.find(0), nullptr);
+      // an ordinary table afterwards
+      map.insert(1, 1);
+      EXPECT_TRUE(map.erase(1));
+      EXPECT_EQ(map.len(), n);
+    }
+  }
+}
+
+TEST(FlatHashMap, BulkBuildAtFullLoadDefersOverflow) {
+  // exactly the growth limit of 2^14 slots: many probes leave their region
+  size_t n = 14336;
+  std::vector<std::pair<int, int>> items;
+  for (int i = 0; i < static_cast<int>(n); i++) {
+    items.push_back({ i, -i });
+  }
+  auto map = FlatHashMap<int, int>::bulk_build(items, 4);
+  EXPECT_EQ(map.capacity_, 16384);
+  EXPECT_EQ(map.len(), n);
+  EXPECT_EQ(map.growth_left_, 0);
+  size_t full = 0;
+  for (size_t i = 0; i < map.capacity_; i++) {
+    full += IsFull(map.ctrl_[i]);
+  }
+  EXPECT_EQ(full, n);
+  for (int i = 0; i < static_cast<int>(n); i++) {
+    ASSERT_NE(map.find(i), nullptr) << i;
+    EXPECT_EQ(*map.find(i), -i);
+  }
+}
+
+TEST(FlatHashMap, BulkBuildDuplicates) {
+  std::vector<std::pair<int, int>> items;
+  for (int round = 1; round <= 3; round++) {
+    for (int key = 0; key < 5000; key++) {
+      items.push_back({ key, round });
+    }
+  }
+  using Map = FlatHashMap<int, int>;
+  auto first = Map::bulk_build(items, 4, Map::OnDuplicate::KeepFirst);
+  auto last = Map::bulk_build(items, 4, Map::OnDuplicate::KeepLast);
+  auto sum = Map::bulk_build(items, 4, [](int& stored, const int& value) {
+    stored += value;
+  });
+  for (auto* map : { &first, &last, &sum }) {
+    EXPECT_EQ(map->len(), 5000);
+  }
+  for (int key = 0; key < 5000; key++) {
+    EXPECT_EQ(*first.find(key), 1);
+    EXPECT_EQ(*last.find(key), 3);
+    EXPECT_EQ(*sum.find(key), 6);
   }
 }
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+// every table type below uses a key or hasher of this file only, so these
+// instantiations do not clash with the ones other tests build without stats
+#define DSUN_HASH_STATS 1
+#include "../src/hash.h"
+#include "../src/swiss_table.h"
+
+using namespace dsun;
+
+namespace {
+  enum class StatKey : uint64_t {};
+
+  struct StatHash {
+    using is_avalanching = void;
+    size_t operator()(uint64_t key) const {
+      return mix(key);
+    }
+  };
+
+  // every key starts probing at the same group
+  struct CollidingHash {
+    size_t operator()(uint64_t) const {
+      return 0;
+    }
+  };
+
+  size_t weighted_sum(const std::vector<size_t>& histogram) {
+    size_t sum = 0;
+    for (size_t i = 0; i < histogram.size(); i++) {
+      sum += i * histogram[i];
+    }
+    return sum;
+  }
+}
+
+static_assert(std::is_empty_v<hash_stats::LookupCounters<false>>);
+
+TEST(HashStatsTest, FlatHashMapShapeAndLookups) {
+  SwissTables::FlatHashMap<uint64_t, uint64_t, StatHash> map(1024);
+  for (uint64_t i = 0; i < 800; i++) {
+    map.insert(i, i);
+  }
+  TableStats stats = map.stats();
+  EXPECT_EQ(stats.len, 800);
+  EXPECT_EQ(stats.capacity, 1024);
+  EXPECT_DOUBLE_EQ(stats.load_factor, 800.0 / 1024);
+  EXPECT_EQ(stats.tombstones, 0);
+  EXPECT_TRUE(stats.chain_lengths.empty());
+  EXPECT_EQ(std::accumulate(stats.probe_lengths.begin(), stats.probe_lengths.end(), size_t(0)), 800);
+  EXPECT_GE(stats.bytes_allocated, 1024 * (1 + sizeof(std::pair<uint64_t, uint64_t>)));
+  // every insert looked its key up and missed
+  EXPECT_EQ(stats.misses.lookups, 800);
+  EXPECT_EQ(stats.hits.lookups, 0);
+
+  map.reset_stats();
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.find(i);
+  }
+  stats = map.stats();
+  EXPECT_EQ(stats.hits.lookups, 800);
+  EXPECT_EQ(stats.misses.lookups, 200);
+  // a hit probes one group more than the groups it stepped past
+  EXPECT_EQ(stats.hits.total, 800 + weighted_sum(stats.probe_lengths));
+  EXPECT_EQ(stats.hits.max, stats.probe_lengths.size());
+  EXPECT_GE(stats.misses.average(), 1.0);
+}
+
+TEST(HashStatsTest, FlatHashMapTombstonesAndLongProbes) {
+  SwissTables::FlatHashMap<uint64_t, uint64_t, CollidingHash> map(64);
+  // leaves the last group reached partly free with 8- and 16-wide groups
+  for (uint64_t i = 0; i < 44; i++) {
+    map.insert(i, i);
+  }
+  TableStats stats = map.stats();
+  EXPECT_GT(stats.probe_lengths.size(), 1);
+  // the home group is full, so erasing from it leaves a tombstone
+  map.erase(0);
+  stats = map.stats();
+  EXPECT_EQ(stats.tombstones, 1);
+  EXPECT_EQ(stats.len, 43);
+
+  map.reset_stats();
+  EXPECT_FALSE(map.contains(1000));
+  stats = map.stats();
+  EXPECT_EQ(stats.misses.lookups, 1);
+  // the miss stops at the last group the keys reached, the first with room
+  EXPECT_EQ(stats.misses.max, stats.probe_lengths.size());
+}
+
+TEST(HashStatsTest, NodeMapCountsItsNodes) {
+  SwissTables::FlatHashMap<uint64_t, uint64_t, StatHash> flat(64);
+  SwissTables::FlatNodeHashMap<uint64_t, uint64_t, StatHash> nodes(64);
+  for (uint64_t i = 0; i < 10; i++) {
+    flat.insert(i, i);
+    nodes.insert(i, i);
+  }
+  // 64 ctrl bytes and the sentinel, padded to the slot alignment
+  size_t ctrl = 72;
+  EXPECT_EQ(nodes.stats().bytes_allocated, ctrl + 64 * sizeof(void*) + 10 * 2 * sizeof(uint64_t));
+  EXPECT_EQ(flat.stats().bytes_allocated, ctrl + 64 * 2 * sizeof(uint64_t));
+}
+
+TEST(HashStatsTest, HashMapChainsAndLookups) {
+  HashMap<StatKey, int> map;
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.insert(StatKey{ i }, 1);
+  }
+  map.reserve(1000);
+  TableStats stats = map.stats();
+  EXPECT_EQ(stats.len, 1000);
+  EXPECT_EQ(stats.tombstones, 0);
+  EXPECT_TRUE(stats.probe_lengths.empty());
+  EXPECT_EQ(std::accumulate(stats.chain_lengths.begin(), stats.chain_lengths.end(), size_t(0)), stats.capacity);
+  EXPECT_EQ(weighted_sum(stats.chain_lengths), 1000);
+  EXPECT_GE(stats.bytes_allocated, stats.capacity * sizeof(void*) + 1000 * (sizeof(StatKey) + sizeof(int)));
+
+  map.reset_stats();
+  for (uint64_t i = 0; i < 1500; i++) {
+    map.contains_key(StatKey{ i });
+  }
+  stats = map.stats();
+  EXPECT_EQ(stats.hits.lookups, 1000);
+  EXPECT_EQ(stats.misses.lookups, 500);
+  EXPECT_GE(stats.hits.average(), 1.0);
+  EXPECT_EQ(stats.hits.max, stats.chain_lengths.size() - 1);
+
+  // a copy starts counting from zero
+  HashMap<StatKey, int> copy = map;
+  EXPECT_EQ(copy.stats().hits.lookups, 0);
+  EXPECT_EQ(copy.stats().len, 1000);
+}
+
+TEST(HashStatsTest, HashMapMidResize) {
+  HashMap<StatKey, int> map;
+  for (uint64_t i = 0; i < 17; i++) {
+    map.insert(StatKey{ i }, 1);
+  }
+  ASSERT_TRUE(map.is_rehashing());
+  TableStats stats = map.stats();
+  EXPECT_EQ(weighted_sum(stats.chain_lengths), 17);
+  // both bucket arrays are held until the move finishes
+  EXPECT_GT(stats.bytes_allocated, (32 + 16) * sizeof(void*));
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include "../src/hash.h"
+
+struct Point {
+  int32_t x;
+  int32_t y;
+  bool operator==(const Point&) const = default;
+};
+DERIVE_HASH(Point)
+HASH_CLASS_ATTRIBUTE(x)
+HASH_CLASS_ATTRIBUTE(y)
+END_DERIVE_HASH()
+
+// padding between the fields, hashed attribute by attribute
+struct Padded {
+  char tag;
+  int64_t value;
+  bool operator==(const Padded& other) const {
+    return tag == other.tag && value == other.value;
+  }
+};
+DERIVE_HASH(Padded)
+HASH_CLASS_ATTRIBUTE(tag)
+HASH_CLASS_ATTRIBUTE(value)
+END_DERIVE_HASH()
+
+TEST(HasherTest, BytesAreDeterministic) {
+  std::string text = "the quick brown fox jumps over the lazy dog";
+  EXPECT_EQ(dsun::hash_bytes(text.data(), text.size()), dsun::hash_bytes(text.data(), text.size()));
+  EXPECT_NE(dsun::hash_bytes(text.data(), text.size()), dsun::hash_bytes(text.data(), text.size(), 1));
+}
+
+TEST(HasherTest, EveryByteAndLengthMatters) {
+  std::vector<unsigned char> data(200);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<unsigned char>(i * 7);
+  }
+  std::set<uint64_t> seen;
+  for (size_t len = 0; len <= data.size(); len++) {
+    uint64_t base = dsun::hash_bytes(data.data(), len);
+    EXPECT_TRUE(seen.insert(base).second) << "length " << len;
+    for (size_t i = 0; i < len; i++) {
+      data[i] ^= 1;
+      EXPECT_NE(dsun::hash_bytes(data.data(), len), base) << "length " << len << " byte " << i;
+      data[i] ^= 1;
+    }
+  }
+}
+
+TEST(HasherTest, MixSpreadsSequentialIntegers) {
+  // the top 4 bits pick one of 16 buckets; 1024 sequential keys should hit
+  // every bucket, which the identity hash never does
+  size_t counts[16] = {};
+  dsun::Hash<int> hash;
+  for (int i = 0; i < 1024; i++) {
+    counts[static_cast<uint64_t>(hash(i)) >> 60]++;
+  }
+  for (size_t count : counts) {
+    EXPECT_GT(count, 32);
+    EXPECT_LT(count, 100);
+  }
+}
+
+TEST(HasherTest, CombineIsOrderSensitive) {
+  uint64_t a = dsun::mix(1);
+  uint64_t b = dsun::mix(2);
+  EXPECT_NE(dsun::hash_combine(dsun::hash_combine(0, a), b), dsun::hash_combine(dsun::hash_combine(0, b), a));
+}
+
+TEST(HasherTest, StringsAndViewsAgree) {
+  std::string owned = "transparent";
+  std::string_view view = owned;
+  EXPECT_EQ(dsun::Hash<std::string>{}(owned), dsun::Hash<std::string_view>{}(view));
+  EXPECT_EQ(dsun::Hash<std::string>{}(owned), dsun::hash_bytes(owned.data(), owned.size()));
+}
+
+TEST(HasherTest, DeriveHashUsesBytesWithoutPadding) {
+  Point point{ 3, -4 };
+  EXPECT_EQ(std::hash<Point>{}(point), dsun::hash_bytes(&point, sizeof(point)));
+  EXPECT_NE(std::hash<Point>{}(point), std::hash<Point>{}(Point{ -4, 3 }));
+}
+
+TEST(HasherTest, DeriveHashIgnoresPadding) {
+  Padded a;
+  Padded b;
+  std::memset(&a, 0x00, sizeof(a));
+  std::memset(&b, 0xFF, sizeof(b));
+  a.tag = b.tag = 'x';
+  a.value = b.value = 42;
+  EXPECT_EQ(std::hash<Padded>{}(a), std::hash<Padded>{}(b));
+
+  dsun::HashMap<Padded, int> map;
+  map.insert(a, 1);
+  EXPECT_EQ(map.get(b).value(), 1);
+}
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 #include "../src/hash.h"
 #include <string>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
 
 
 class HashmapTest : public ::testing::Test {
@@ -113,4 +120,462 @@ TEST_F(HashmapTest, EntryAndModifyTest) {
     }).or_insert("two");
   EXPECT_EQ(entry2, "two");
   EXPECT_EQ(entry, "OneOne");
-}
\ No newline at end of file
+}
+TEST(HashMapGrowthTest, GrowsWithLoadFactor) {
+  dsun::HashMap<int, int> map;
+  EXPECT_EQ(map.capacity(), 16);
+  for (int i = 0; i < 10000; i++) {
+    map.insert(i, i * 2);
+  }
+  EXPECT_EQ(map.len(), 10000);
+  EXPECT_GE(map.capacity(), 8192);
+  EXPECT_LE(map.load_factor(), map.max_load_factor() * 2);
+  for (int i = 0; i < 10000; i++) {
+    ASSERT_EQ(map.get(i).value(), i * 2);
+  }
+  EXPECT_FALSE(map.contains_key(10000));
+}
+
+TEST(HashMapGrowthTest, RehashIsIncremental) {
+  dsun::HashMap<int, int> map;
+  int key = 0;
+  while (!map.is_rehashing()) {
+    map.insert(key, key);
+    key++;
+  }
+  EXPECT_EQ(map.capacity(), 32);
+  // every key is still reachable while buckets are being migrated
+  for (int i = 0; i < key; i++) {
+    EXPECT_TRUE(map.contains_key(i));
+  }
+  size_t seen = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    seen++;
+  }
+  EXPECT_EQ(seen, map.len());
+
+  EXPECT_EQ(map.remove(0).value(), 0);
+  map.insert(key, key);
+  EXPECT_FALSE(map.is_rehashing());
+  for (int i = 1; i <= key; i++) {
+    EXPECT_TRUE(map.contains_key(i));
+  }
+  EXPECT_FALSE(map.contains_key(0));
+}
+
+TEST(HashMapGrowthTest, MaxLoadFactorAndReserve) {
+  dsun::HashMap<int, int> map;
+  map.set_max_load_factor(0.5f);
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_GE(map.capacity(), 200);
+
+  auto reserved = dsun::HashMap<int, int>::with_capacity(1000);
+  size_t capacity = reserved.capacity();
+  EXPECT_GE(capacity, 1000);
+  for (int i = 0; i < 1000; i++) {
+    reserved.insert(i, i);
+  }
+  EXPECT_EQ(reserved.capacity(), capacity);
+  EXPECT_FALSE(reserved.is_rehashing());
+}
+
+TEST(HashMapGrowthTest, RejectsBadMaxLoadFactor) {
+  dsun::HashMap<int, int> map;
+  map.insert(1, 1);
+  for (float bad : { 0.0f, -1.0f, std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() }) {
+    EXPECT_THROW(map.set_max_load_factor(bad), std::invalid_argument);
+  }
+  EXPECT_EQ(map.max_load_factor(), 1.0f);
+  // a tiny factor asks for more buckets than can exist: the count is
+  // capped, so it fails to allocate rather than looping forever
+  EXPECT_THROW(map.set_max_load_factor(1e-30f), std::bad_alloc);
+  EXPECT_EQ(map.max_load_factor(), 1.0f);
+  EXPECT_EQ(*map.find(1), 1);
+}
+
+TEST(HashMapGrowthTest, CopyIsDeep) {
+  dsun::HashMap<int, std::string> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, std::to_string(i));
+  }
+  dsun::HashMap<int, std::string> copy(map);
+  map.remove(1);
+  *map.get_mut(2).value() = "changed";
+  EXPECT_EQ(copy.len(), 100);
+  EXPECT_EQ(copy.get(1).value(), "1");
+  EXPECT_EQ(copy.get(2).value(), "2");
+}
+
+TEST(HashMapLookupTest, InsertUpdatesExistingKey) {
+  dsun::HashMap<int, std::string> map;
+  map.insert(1, "one");
+  map.insert(1, "uno");
+  EXPECT_EQ(map.len(), 1);
+  EXPECT_EQ(map.get(1).value(), "uno");
+  EXPECT_EQ(map.remove(1).value(), "uno");
+  EXPECT_FALSE(map.contains_key(1));
+}
+
+TEST(HashMapLookupTest, FindReturnsPointer) {
+  dsun::HashMap<int, std::string> map;
+  map.insert(1, "one");
+  std::string* value = map.find(1);
+  ASSERT_NE(value, nullptr);
+  value->append("!");
+  EXPECT_EQ(*map.find(1), "one!");
+  EXPECT_EQ(map.find(2), nullptr);
+
+  const dsun::HashMap<int, std::string>& view = map;
+  EXPECT_EQ(*view.find(1), "one!");
+  EXPECT_TRUE(view.contains_key(1));
+}
+
+TEST(HashMapLookupTest, FindSurvivesGrowth) {
+  dsun::HashMap<int, int> map;
+  map.insert(0, 42);
+  int* value = map.find(0);
+  for (int i = 1; i < 1000; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(value, map.find(0));
+  EXPECT_EQ(*value, 42);
+}
+
+TEST(HashMapLookupTest, Prehashed) {
+  using Map = dsun::HashMap<std::string, int>;
+  Map map;
+  uint64_t h = Map::hash_of("key");
+  EXPECT_EQ(h, Map::hash_of(std::string("key")));
+  EXPECT_TRUE(map.insert_or_assign("key", h, 1).second);
+  EXPECT_FALSE(map.insert_or_assign(std::string("key"), h, 2).second);
+  EXPECT_EQ(*map.find("key", h), 2);
+  EXPECT_EQ(*map.find("key"), 2);
+  map.entry("key", h).and_modify([](int& value) { value++; });
+  const Map& view = map;
+  EXPECT_EQ(*view.find(std::string_view("key"), h), 3);
+  EXPECT_EQ(map.remove("key", h).value(), 3);
+  EXPECT_EQ(map.find("key", h), nullptr);
+  EXPECT_EQ(map.len(), 0);
+}
+
+TEST(HashMapLookupTest, TryEmplace) {
+  dsun::HashMap<std::string, std::string> map;
+  auto [value, inserted] = map.try_emplace(std::string("key"), 3, 'a');
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(*value, "aaa");
+
+  std::string untouched = "bbb";
+  auto [again, inserted_again] = map.try_emplace(std::string("key"), std::move(untouched));
+  EXPECT_FALSE(inserted_again);
+  EXPECT_EQ(again, value);
+  EXPECT_EQ(*again, "aaa");
+  // not moved from, the value was never constructed
+  EXPECT_EQ(untouched, "bbb");
+}
+
+TEST(HashMapLookupTest, InsertOrAssign) {
+  dsun::HashMap<std::string, std::string> map;
+  auto [value, inserted] = map.insert_or_assign(std::string("key"), std::string("one"));
+  EXPECT_TRUE(inserted);
+  auto [same, inserted_again] = map.insert_or_assign(std::string("key"), std::string("two"));
+  EXPECT_FALSE(inserted_again);
+  EXPECT_EQ(same, value);
+  EXPECT_EQ(*value, "two");
+  EXPECT_EQ(map.len(), 1);
+}
+
+TEST(HashMapLookupTest, HeterogeneousStringLookup) {
+  dsun::HashMap<std::string, int> map;
+  map.insert("apple", 1);
+  map.try_emplace(std::string_view("banana"), 2);
+  map.insert_or_assign("cherry", 3);
+
+  std::string_view banana = "banana";
+  EXPECT_EQ(dsun::Hash<std::string>{}(banana), dsun::Hash<std::string>{}(std::string(banana)));
+  EXPECT_EQ(*map.find(banana), 2);
+  EXPECT_EQ(*map.find("apple"), 1);
+  EXPECT_EQ(map.get(std::string_view("cherry")).value(), 3);
+  EXPECT_TRUE(map.contains_key(std::string_view("apple")));
+  EXPECT_FALSE(map.contains_key(std::string_view("durian")));
+  EXPECT_EQ(map.remove(std::string_view("apple")).value(), 1);
+  EXPECT_EQ(map.len(), 2);
+}
+
+TEST(HashMapLookupTest, IteratorYieldsReferences) {
+  dsun::HashMap<int, int> map;
+  for (int i = 0; i < 10; i++) {
+    map.insert(i, i);
+  }
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    it.get_mut().second *= 2;
+  }
+  for (auto [key, value] : map) {
+    EXPECT_EQ(value, key * 2);
+  }
+}
+
+TEST(HashMapEntryTest, OrInsertReturnsReference) {
+  dsun::HashMap<std::string, int> counts;
+  for (const char* word : { "a", "b", "a", "c", "a", "b" }) {
+    counts.entry(word).or_insert(0) += 1;
+  }
+  EXPECT_EQ(counts.len(), 3);
+  EXPECT_EQ(*counts.find("a"), 3);
+  EXPECT_EQ(*counts.find("b"), 2);
+  EXPECT_EQ(*counts.find("c"), 1);
+}
+
+TEST(HashMapEntryTest, OrInsertWithIsLazy) {
+  dsun::HashMap<int, std::string> map;
+  map.insert(1, "one");
+  int calls = 0;
+  auto make = [&]() {
+    calls++;
+    return std::string("made");
+  };
+  EXPECT_EQ(map.entry(1).or_insert_with(make), "one");
+  EXPECT_EQ(calls, 0);
+  EXPECT_EQ(map.entry(2).or_insert_with(make), "made");
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(map.entry(3).or_default(), "");
+  EXPECT_EQ(map.len(), 3);
+}
+
+TEST(HashMapEntryTest, OccupiedAndVacant) {
+  dsun::HashMap<int, int> map;
+  map.insert(1, 10);
+  auto occupied = map.entry(1);
+  EXPECT_TRUE(occupied.is_occupied());
+  EXPECT_EQ(occupied.key(), 1);
+  auto vacant = map.entry(2);
+  EXPECT_FALSE(vacant.is_occupied());
+  EXPECT_EQ(vacant.key(), 2);
+  int& value = vacant.and_modify([](int& v) { v = -1; }).or_insert(20);
+  EXPECT_EQ(value, 20);
+  EXPECT_TRUE(vacant.is_occupied());
+  // a second or_insert on the same entry sees the inserted value
+  EXPECT_EQ(&vacant.or_insert(30), &value);
+  EXPECT_EQ(map.len(), 2);
+}
+
+TEST(HashMapEntryTest, WorksAcrossGrowth) {
+  dsun::HashMap<int, int> map;
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 2000; i++) {
+      map.entry(i).and_modify([](int& v) { v++; }).or_insert(1);
+    }
+  }
+  EXPECT_EQ(map.len(), 2000);
+  for (int i = 0; i < 2000; i++) {
+    EXPECT_EQ(map.get(i).value(), 3);
+  }
+}
+
+struct Counted {
+  static inline int live = 0;
+  int value;
+  Counted(int value = 0) : value(value) {
+    live++;
+  }
+  Counted(const Counted& other) : value(other.value) {
+    live++;
+  }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() {
+    live--;
+  }
+};
+
+TEST(HashMapPoolTest, DestructorReleasesEntries) {
+  {
+    dsun::HashMap<int, Counted> map;
+    for (int i = 0; i < 1000; i++) {
+      map.insert(i, Counted(i));
+    }
+    EXPECT_EQ(Counted::live, 1000);
+    for (int i = 0; i < 500; i++) {
+      map.remove(i);
+    }
+    EXPECT_EQ(Counted::live, 500);
+  }
+  EXPECT_EQ(Counted::live, 0);
+}
+
+TEST(HashMapPoolTest, RemovedNodesAreReused) {
+  dsun::HashMap<int, int> map = dsun::HashMap<int, int>::with_capacity(64);
+  map.insert(1, 1);
+  int* first = map.find(1);
+  map.remove(1);
+  map.insert(2, 2);
+  EXPECT_EQ(map.find(2), first);
+}
+
+TEST(HashMapPoolTest, Clear) {
+  dsun::HashMap<int, Counted> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, Counted(i));
+  }
+  map.clear();
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_EQ(Counted::live, 0);
+  EXPECT_FALSE(map.contains_key(1));
+  map.insert(1, Counted(1));
+  EXPECT_EQ(map.find(1)->value, 1);
+}
+
+static_assert(std::is_nothrow_move_constructible_v<dsun::HashMap<int, std::string>>);
+static_assert(std::is_nothrow_move_assignable_v<dsun::HashMap<int, std::string>>);
+
+TEST(HashMapPoolTest, MoveLeavesSourceUsable) {
+  dsun::HashMap<int, std::string> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, std::to_string(i));
+  }
+  dsun::HashMap<int, std::string> moved(std::move(map));
+  EXPECT_EQ(moved.len(), 100);
+  EXPECT_EQ(*moved.find(42), "42");
+  // the source keeps no buckets, and lookups on it still work
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_EQ(map.capacity(), 0);
+  EXPECT_EQ(map.find(42), nullptr);
+  EXPECT_FALSE(map.remove(42).has_value());
+  EXPECT_EQ(map.begin(), map.end());
+  map.insert(1, "one");
+  EXPECT_EQ(*map.find(1), "one");
+
+  map = std::move(moved);
+  EXPECT_EQ(map.len(), 100);
+}
+
+TEST(HashMapBatchTest, GetManyAndContainsMany) {
+  dsun::HashMap<int, int> map;
+  for (int i = 0; i < 1000; i += 2) {
+    map.insert(i, i * 10);
+  }
+  // more than one batch, with a partial one at the end
+  std::vector<int> keys;
+  for (int i = 0; i < 101; i++) {
+    keys.push_back(i * 7);
+  }
+  std::vector<const int*> values(keys.size());
+  map.get_many(keys, values);
+  std::unique_ptr<bool[]> present(new bool[keys.size()]);
+  size_t found = map.contains_many(keys, std::span<bool>(present.get(), keys.size()));
+  size_t expected = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    bool even = keys[i] % 2 == 0 && keys[i] < 1000;
+    expected += even;
+    EXPECT_EQ(present[i], even);
+    if (even) {
+      ASSERT_NE(values[i], nullptr);
+      EXPECT_EQ(*values[i], keys[i] * 10);
+    }
+    else {
+      EXPECT_EQ(values[i], nullptr);
+    }
+  }
+  EXPECT_EQ(found, expected);
+}
+
+TEST(HashMapBatchTest, GetManyWhileRehashing) {
+  dsun::HashMap<int, int> map;
+  int key = 0;
+  while (!map.is_rehashing()) {
+    map.insert(key, key);
+    key++;
+  }
+  std::vector<int> keys;
+  for (int i = 0; i <= key; i++) {
+    keys.push_back(i);
+  }
+  std::vector<const int*> values(keys.size());
+  map.get_many(keys, values);
+  for (int i = 0; i < key; i++) {
+    EXPECT_EQ(*values[i], i);
+  }
+  EXPECT_EQ(values[key], nullptr);
+}
+
+TEST(HashMapFileTest, SaveAndLoad) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_hashmap_test.bin").string();
+  dsun::HashMap<uint64_t, double> map;
+  for (uint64_t i = 0; i < 5000; i++) {
+    map.insert(i * 3, static_cast<double>(i) / 2);
+  }
+  map.remove(3);
+  ASSERT_TRUE(map.save(path.c_str()));
+
+  auto loaded = dsun::HashMap<uint64_t, double>::load(path.c_str());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->len(), map.len());
+  EXPECT_EQ(loaded->capacity(), map.capacity());
+  EXPECT_FALSE(loaded->contains_key(3));
+  for (uint64_t i = 2; i < 5000; i++) {
+    EXPECT_EQ(*loaded->find(i * 3), static_cast<double>(i) / 2);
+  }
+  // still a normal map after loading
+  loaded->insert(1, 1.0);
+  EXPECT_EQ(loaded->get(1).value(), 1.0);
+
+  // other value types and missing files are rejected
+  EXPECT_FALSE((dsun::HashMap<uint64_t, uint32_t>::load(path.c_str()).has_value()));
+  EXPECT_FALSE((dsun::HashMap<uint64_t, double>::load("/nonexistent/dsun.bin").has_value()));
+  std::filesystem::remove(path);
+}
+
+TEST(HashMapFileTest, RejectsTruncatedFile) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_hashmap_truncated.bin").string();
+  dsun::HashMap<int, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  ASSERT_TRUE(map.save(path.c_str()));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_FALSE((dsun::HashMap<int, int>::load(path.c_str()).has_value()));
+  std::filesystem::remove(path);
+}
+
+TEST(HashMapFileTest, IgnoresCorruptCapacity) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_hashmap_capacity.bin").string();
+  dsun::HashMap<int, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  ASSERT_TRUE(map.save(path.c_str()));
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  dsun::table_file::Header header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  header.capacity = uint64_t(1) << 62;
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.close();
+  // the buckets are sized from len, so nothing huge is allocated
+  auto loaded = dsun::HashMap<int, int>::load(path.c_str());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->capacity(), map.capacity());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(*loaded->find(i), i);
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(HashMapFileTest, RejectsOverflowingLen) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_hashmap_len.bin").string();
+  dsun::HashMap<int, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i);
+  }
+  ASSERT_TRUE(map.save(path.c_str()));
+  // a record is 16 bytes, so this len times the record size wraps to 16
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  dsun::table_file::Header header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  header.len = (uint64_t(1) << 60) + 1;
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.close();
+  EXPECT_FALSE((dsun::HashMap<int, int>::load(path.c_str()).has_value()));
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#define private public
+#include "../src/index_map.h"
+
+using namespace dsun;
+
+namespace {
+  // every key wants the same slot
+  struct CollidingHash {
+    size_t operator()(uint64_t) const {
+      return 0;
+    }
+  };
+
+  // every entry is reachable from its home slot without crossing a free
+  // slot, and every slot points at a distinct entry
+  template <typename Map>
+  bool index_consistent(const Map& map) {
+    size_t used = 0;
+    bool ok = true;
+    Map::visit_index(map, [&](const auto& slots) {
+      std::vector<bool> seen(map.len());
+      for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i] == 0) {
+          continue;
+        }
+        used++;
+        size_t position = slots[i] - 1;
+        if (position >= map.len() || seen[position]) {
+          ok = false;
+          return;
+        }
+        seen[position] = true;
+        for (size_t j = map.home(map.entries_[position].hash); j != i; j = (j + 1) & map.mask_) {
+          ok &= slots[j] != 0;
+        }
+      }
+      });
+    return ok && used == map.len();
+  }
+
+  template <typename Map>
+  std::vector<typename Map::Entry> entries_of(const Map& map) {
+    return { map.begin(), map.end() };
+  }
+}
+
+TEST(IndexMapTest, InsertFindRemove) {
+  IndexMap<std::string, int> map;
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_TRUE(map.insert("a", 1));
+  EXPECT_TRUE(map.insert("b", 2));
+  EXPECT_FALSE(map.insert("a", 3));
+  EXPECT_EQ(map.len(), 2);
+  EXPECT_EQ(*map.find("a"), 3);
+  EXPECT_EQ(map.get(std::string_view("b")).value(), 2);
+  EXPECT_FALSE(map.contains_key("c"));
+  EXPECT_EQ(map.index_of("b").value(), 1);
+  EXPECT_EQ(map.remove("a").value(), 3);
+  EXPECT_FALSE(map.remove("a").has_value());
+  EXPECT_EQ(map.index_of("b").value(), 0);
+  map.clear();
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_FALSE(map.contains_key("b"));
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(IndexMapTest, IteratesInInsertionOrder) {
+  IndexMap<std::string, int> map;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 500; i++) {
+    keys.push_back("key" + std::to_string((i * 7919) % 1000));
+    map.insert(keys.back(), i);
+  }
+  // replacing a value keeps its place
+  map.insert(keys[10], -1);
+  size_t i = 0;
+  map.for_each([&](const std::string& key, const int& value) {
+    EXPECT_EQ(key, keys[i]);
+    EXPECT_EQ(value, i == 10 ? -1 : static_cast<int>(i));
+    i++;
+    });
+  EXPECT_EQ(i, keys.size());
+  map.for_each_mut([](const std::string&, int& value) {
+    value *= 2;
+    });
+  EXPECT_EQ(map.at(3).first, keys[3]);
+  EXPECT_EQ(map.at(3).second, 6);
+}
+
+TEST(IndexMapTest, IndexWidensWithTheEntries) {
+  IndexMap<uint64_t, uint64_t> map;
+  EXPECT_EQ(map.index_.index(), 0);
+  for (uint64_t i = 0; i < 128; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.index_.index(), 0);
+  map.insert(128, 128);
+  EXPECT_EQ(map.index_.index(), 1);
+  for (uint64_t i = 129; i < 32768; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.index_.index(), 1);
+  map.insert(32768, 32768);
+  EXPECT_EQ(map.index_.index(), 2);
+  EXPECT_TRUE(index_consistent(map));
+  for (uint64_t i = 0; i <= 32768; i++) {
+    ASSERT_EQ(*map.find(i), i);
+    ASSERT_EQ(map.index_of(i).value(), i);
+  }
+  // reserve picks the width up front
+  IndexMap<uint64_t, uint64_t> reserved(1000);
+  EXPECT_EQ(reserved.index_.index(), 1);
+  EXPECT_EQ(reserved.stats().capacity, 2048);
+}
+
+TEST(IndexMapTest, RemovesKeepTheMirrorOrder) {
+  IndexMap<uint64_t, uint64_t> map;
+  std::vector<uint64_t> mirror;
+  std::mt19937_64 rng(1);
+  for (int round = 0; round < 5000; round++) {
+    uint64_t choice = rng() % 4;
+    if (mirror.empty() || choice < 2) {
+      uint64_t key = rng() % 3000;
+      if (map.insert(key, key + 1)) {
+        mirror.push_back(key);
+      }
+    }
+    else {
+      size_t at = rng() % mirror.size();
+      uint64_t key = mirror[at];
+      if (choice == 2) {
+        ASSERT_EQ(map.remove(key).value(), key + 1);
+        mirror.erase(mirror.begin() + at);
+      }
+      else {
+        ASSERT_EQ(map.swap_remove(key).value(), key + 1);
+        mirror[at] = mirror.back();
+        mirror.pop_back();
+      }
+    }
+  }
+  ASSERT_TRUE(index_consistent(map));
+  auto entries = entries_of(map);
+  ASSERT_EQ(entries.size(), mirror.size());
+  for (size_t i = 0; i < mirror.size(); i++) {
+    ASSERT_EQ(entries[i].key, mirror[i]);
+    ASSERT_EQ(*map.find(mirror[i]), mirror[i] + 1);
+  }
+}
+
+TEST(IndexMapTest, CollidingKeysShiftBackOnRemove) {
+  IndexMap<uint64_t, uint64_t, CollidingHash> map;
+  for (uint64_t i = 0; i < 6; i++) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.stats().probe_lengths.size(), 6);
+  map.swap_remove(uint64_t(0));
+  map.remove(uint64_t(3));
+  EXPECT_TRUE(index_consistent(map));
+  // the run closed up behind the removed keys
+  EXPECT_EQ(map.stats().probe_lengths.size(), 4);
+  std::vector<uint64_t> keys;
+  for (const auto& entry : map) {
+    keys.push_back(entry.key);
+  }
+  EXPECT_EQ(keys, (std::vector<uint64_t>{ 5, 1, 2, 4 }));
+}
+
+TEST(IndexMapTest, SmallerThanHashMap) {
+  IndexMap<uint64_t, uint64_t> map;
+  HashMap<uint64_t, uint64_t> chained;
+  for (uint64_t i = 0; i < 1000; i++) {
+    map.insert(i, i);
+    chained.insert(i, i);
+  }
+  TableStats stats = map.stats();
+  EXPECT_EQ(stats.len, 1000);
+  EXPECT_LE(stats.load_factor, 0.5);
+  EXPECT_EQ(stats.bytes_allocated, 1024 * sizeof(IndexMap<uint64_t, uint64_t>::Entry) + 2048 * sizeof(uint16_t));
+  EXPECT_LT(stats.bytes_allocated, chained.stats().bytes_allocated);
+}
+
+TEST(IndexMapTest, RemovedValuesAreReleased) {
+  IndexMap<uint64_t, std::shared_ptr<int>> map;
+  auto shared = std::make_shared<int>(7);
+  for (uint64_t i = 0; i < 10; i++) {
+    map.insert(i, shared);
+  }
+  EXPECT_EQ(shared.use_count(), 11);
+  map.remove(uint64_t(3));
+  EXPECT_EQ(shared.use_count(), 10);
+  map.swap_remove(uint64_t(0));
+  EXPECT_EQ(shared.use_count(), 9);
+  // 9 moved to the front, so 8 is last and is removed in place
+  map.swap_remove(uint64_t(8));
+  EXPECT_EQ(shared.use_count(), 8);
+  map.clear();
+  EXPECT_EQ(shared.use_count(), 1);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "../src/linked_list.h" // Assuming your LinkedList class is defined in LinkedList.h
+#include <vector>
 
 using namespace dsun;
 
@@ -250,3 +251,117 @@ TEST(HighOrderFunctions, filter) {
     EXPECT_EQ(*it, (it.index() * 20) + 20);
   }
 }
+
+static std::vector<int> to_vector(const LinkedList<int>& list) {
+  std::vector<int> out;
+  for (auto value : list) {
+    out.push_back(value);
+  }
+  return out;
+}
+
+// pops every element from the back, checking the prev links
+static std::vector<int> drain_from_back(LinkedList<int>& list) {
+  std::vector<int> out;
+  while (auto value = list.pop_back()) {
+    out.insert(out.begin(), value.value());
+  }
+  return out;
+}
+
+TEST(RelinkLinkedListTest, Append) {
+  auto list = LinkedList<int>::from_list({ 1, 2 });
+  auto other = LinkedList<int>::from_list({ 3, 4 });
+  list.append(other);
+  EXPECT_EQ(list.len(), 4);
+  EXPECT_TRUE(other.is_empty());
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 1, 2, 3, 4 }));
+  EXPECT_EQ(list.back().value(), 4);
+
+  LinkedList<int> empty;
+  empty.append(list);
+  EXPECT_EQ(empty.len(), 4);
+  EXPECT_TRUE(list.is_empty());
+}
+
+TEST(RelinkLinkedListTest, Splice) {
+  auto list = LinkedList<int>::from_list({ 1, 5 });
+  auto middle = LinkedList<int>::from_list({ 2, 3, 4 });
+  list.splice(1, middle);
+  EXPECT_TRUE(middle.is_empty());
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 1, 2, 3, 4, 5 }));
+
+  auto front = LinkedList<int>::from_list({ 0 });
+  list.splice(0, front);
+  auto back = LinkedList<int>::from_list({ 6 });
+  list.splice(list.len(), back);
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 0, 1, 2, 3, 4, 5, 6 }));
+  EXPECT_EQ(list.front().value(), 0);
+  EXPECT_EQ(list.back().value(), 6);
+  EXPECT_THROW(list.splice(8, back), std::out_of_range);
+  EXPECT_EQ(drain_from_back(list), std::vector<int>({ 0, 1, 2, 3, 4, 5, 6 }));
+}
+
+TEST(RelinkLinkedListTest, SplitOff) {
+  auto list = LinkedList<int>::from_list({ 1, 2, 3, 4, 5 });
+  auto rest = list.split_off(3);
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 1, 2, 3 }));
+  EXPECT_EQ(to_vector(rest), std::vector<int>({ 4, 5 }));
+  EXPECT_EQ(list.back().value(), 3);
+  EXPECT_EQ(rest.front().value(), 4);
+  EXPECT_EQ(drain_from_back(rest), std::vector<int>({ 4, 5 }));
+
+  auto all = list.split_off(0);
+  EXPECT_TRUE(list.is_empty());
+  EXPECT_EQ(all.len(), 3);
+  EXPECT_TRUE(all.split_off(3).is_empty());
+  EXPECT_THROW(all.split_off(4), std::out_of_range);
+}
+
+TEST(RelinkLinkedListTest, Merge) {
+  auto list = LinkedList<int>::from_list({ 1, 4, 6, 9 });
+  auto other = LinkedList<int>::from_list({ 2, 4, 7, 10, 11 });
+  list.merge(other);
+  EXPECT_TRUE(other.is_empty());
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 1, 2, 4, 4, 6, 7, 9, 10, 11 }));
+  EXPECT_EQ(list.back().value(), 11);
+  EXPECT_EQ(drain_from_back(list), std::vector<int>({ 1, 2, 4, 4, 6, 7, 9, 10, 11 }));
+}
+
+TEST(RelinkLinkedListTest, MergeIsStable) {
+  LinkedList<std::pair<int, char>> list;
+  list.push_back({ 1, 'a' });
+  list.push_back({ 2, 'a' });
+  LinkedList<std::pair<int, char>> other;
+  other.push_back({ 1, 'b' });
+  other.push_back({ 2, 'b' });
+  list.merge(other, [](const auto& a, const auto& b) { return a.first < b.first; });
+  EXPECT_EQ(list[0].second, 'a');
+  EXPECT_EQ(list[1].second, 'b');
+  EXPECT_EQ(list[2].second, 'a');
+  EXPECT_EQ(list[3].second, 'b');
+}
+
+TEST(RelinkLinkedListTest, Sort) {
+  auto list = LinkedList<int>::from_list({ 5, 3, 9, 1, 3, 8, 2, 7, 0 });
+  list.sort();
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 0, 1, 2, 3, 3, 5, 7, 8, 9 }));
+  list.sort(std::greater<int>());
+  EXPECT_EQ(to_vector(list), std::vector<int>({ 9, 8, 7, 5, 3, 3, 2, 1, 0 }));
+  EXPECT_EQ(list.front().value(), 9);
+  EXPECT_EQ(list.back().value(), 0);
+  EXPECT_EQ(drain_from_back(list), std::vector<int>({ 9, 8, 7, 5, 3, 3, 2, 1, 0 }));
+}
+
+TEST(RelinkLinkedListTest, SortIsStable) {
+  LinkedList<std::pair<int, int>> list;
+  for (int i = 0; i < 100; i++) {
+    list.push_back({ (i * 37) % 10, i });
+  }
+  list.sort([](const auto& a, const auto& b) { return a.first < b.first; });
+  std::pair<int, int> prev = { -1, -1 };
+  for (auto value : list) {
+    EXPECT_TRUE(prev.first < value.first || (prev.first == value.first && prev.second < value.second));
+    prev = value;
+  }
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/skip_list.h"
+
+using namespace dsun;
+
+TEST(SkipListMapTest, InsertAndFind) {
+  SkipListMap<int, std::string> map;
+  EXPECT_TRUE(map.insert(2, "two"));
+  EXPECT_TRUE(map.insert(1, "one"));
+  EXPECT_TRUE(map.insert(3, "three"));
+  EXPECT_FALSE(map.insert(2, "deux"));
+
+  EXPECT_EQ(map.len(), 3);
+  EXPECT_EQ(map.find(1).value(), "one");
+  EXPECT_EQ(map.find(2).value(), "two");
+  EXPECT_EQ(map.find(3).value(), "three");
+  EXPECT_FALSE(map.find(4).has_value());
+  EXPECT_TRUE(map.contains(3));
+  EXPECT_FALSE(map.contains(0));
+}
+
+TEST(SkipListMapTest, FindInEmpty) {
+  SkipListMap<int, int> map;
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_FALSE(map.find(1).has_value());
+  EXPECT_FALSE(map.first().has_value());
+  EXPECT_FALSE(map.lower_bound(1).has_value());
+  EXPECT_FALSE(map.remove(1).has_value());
+}
+
+TEST(SkipListMapTest, Remove) {
+  SkipListMap<int, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert(i, i * 10);
+  }
+  for (int i = 0; i < 100; i += 2) {
+    EXPECT_EQ(map.remove(i).value(), i * 10);
+  }
+  EXPECT_FALSE(map.remove(0).has_value());
+  EXPECT_EQ(map.len(), 50);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(map.contains(i), i % 2 == 1);
+  }
+  EXPECT_TRUE(map.insert(0, 1));
+  EXPECT_EQ(map.find(0).value(), 1);
+}
+
+TEST(SkipListMapTest, IteratesInOrder) {
+  SkipListMap<int, int> map;
+  for (int i : { 5, 3, 9, 1, 7, 2, 8 }) {
+    map.insert(i, -i);
+  }
+  std::vector<int> keys;
+  for (auto entry : map) {
+    keys.push_back(entry.first);
+    EXPECT_EQ(entry.second, -entry.first);
+  }
+  EXPECT_EQ(keys, std::vector<int>({ 1, 2, 3, 5, 7, 8, 9 }));
+  EXPECT_EQ(map.first().value().first, 1);
+}
+
+TEST(SkipListMapTest, LowerBoundAndRange) {
+  SkipListMap<int, int> map;
+  for (int i = 0; i < 50; i += 5) {
+    map.insert(i, i);
+  }
+  EXPECT_EQ(map.lower_bound(12).value().first, 15);
+  EXPECT_EQ(map.lower_bound(15).value().first, 15);
+  EXPECT_EQ(map.lower_bound(-3).value().first, 0);
+  EXPECT_FALSE(map.lower_bound(46).has_value());
+
+  std::vector<int> keys;
+  map.range(10, 30, [&](const int& key, const int&) { keys.push_back(key); });
+  EXPECT_EQ(keys, std::vector<int>({ 10, 15, 20, 25 }));
+}
+
+TEST(SkipListMapTest, StringKeys) {
+  SkipListMap<std::string, int> map;
+  map.insert("pear", 1);
+  map.insert("apple", 2);
+  map.insert("fig", 3);
+  EXPECT_EQ(map.first().value().first, "apple");
+  EXPECT_EQ(map.lower_bound("b").value().first, "fig");
+}
+
+TEST(SkipListMapConcurrentTest, DisjointInserts) {
+  SkipListMap<int, int> map;
+  const int threads = 8;
+  const int per_thread = 2000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&map, t]() {
+      for (int i = 0; i < per_thread; i++) {
+        map.insert(i * threads + t, t);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(map.len(), threads * per_thread);
+  int expected = 0;
+  for (auto entry : map) {
+    EXPECT_EQ(entry.first, expected);
+    EXPECT_EQ(entry.second, expected % threads);
+    expected++;
+  }
+  EXPECT_EQ(expected, threads * per_thread);
+}
+
+TEST(SkipListMapConcurrentTest, SameKeyInsertedOnce) {
+  SkipListMap<int, int> map;
+  std::atomic<int> wins{ 0 };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 8; t++) {
+    workers.emplace_back([&]() {
+      for (int i = 0; i < 500; i++) {
+        if (map.insert(i, i)) {
+          wins++;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(wins.load(), 500);
+  EXPECT_EQ(map.len(), 500);
+}
+
+TEST(SkipListMapConcurrentTest, MixedInsertRemoveFind) {
+  SkipListMap<int, int> map;
+  const int keys = 512;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 8; t++) {
+    workers.emplace_back([&map, t]() {
+      uint32_t seed = t + 1;
+      for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        int key = (seed >> 8) % keys;
+        switch (seed % 3) {
+          case 0:
+            map.insert(key, key * 3);
+            break;
+          case 1:
+            map.remove(key);
+            break;
+          default: {
+            auto value = map.find(key);
+            if (value.has_value()) {
+              EXPECT_EQ(value.value(), key * 3);
+            }
+          }
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  size_t count = 0;
+  int prev = -1;
+  for (auto entry : map) {
+    EXPECT_LT(prev, entry.first);
+    prev = entry.first;
+    count++;
+  }
+  EXPECT_EQ(count, map.len());
+}
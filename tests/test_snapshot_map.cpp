@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/snapshot_map.h"
+
+using namespace dsun;
+
+TEST(SnapshotMapTest, InsertGetRemove) {
+  SnapshotMap<int, int> map;
+  EXPECT_EQ(map.len(), 0);
+  EXPECT_FALSE(map.get(1).has_value());
+  map.insert(1, 10);
+  map.insert(2, 20);
+  map.insert(1, 11);
+  EXPECT_EQ(map.len(), 2);
+  EXPECT_EQ(map.get(1).value(), 11);
+  EXPECT_TRUE(map.contains_key(2));
+  map.remove(2);
+  EXPECT_FALSE(map.contains_key(2));
+  EXPECT_EQ(map.len(), 1);
+}
+
+TEST(SnapshotMapTest, BatchLastChangeWins) {
+  SnapshotMap<int, int> map;
+  map.update([](auto& batch) {
+    for (int i = 0; i < 1000; i++) {
+      batch.insert(i, i);
+    }
+    batch.remove(5);
+    batch.insert(6, -6);
+    batch.remove(6);
+    batch.remove(7);
+    batch.insert(7, -7);
+    });
+  EXPECT_EQ(map.len(), 998);
+  EXPECT_FALSE(map.contains_key(5));
+  EXPECT_FALSE(map.contains_key(6));
+  EXPECT_EQ(map.get(7).value(), -7);
+  EXPECT_EQ(map.get(999).value(), 999);
+}
+
+TEST(SnapshotMapTest, ViewIsStable) {
+  SnapshotMap<int, int> map;
+  map.insert(1, 1);
+  {
+    auto view = map.view();
+    map.insert(1, 2);
+    map.insert(3, 3);
+    // the view still sees the snapshot it pinned
+    EXPECT_EQ(*view.find(1), 1);
+    EXPECT_FALSE(view.contains_key(3));
+    EXPECT_EQ(view.len(), 1);
+  }
+  EXPECT_EQ(map.get(1).value(), 2);
+  size_t seen = 0;
+  map.view().for_each([&](const int& key, const int& value) {
+    EXPECT_EQ(key, value == 2 ? 1 : 3);
+    seen++;
+    });
+  EXPECT_EQ(seen, 2);
+}
+
+TEST(SnapshotMapTest, OldSnapshotsAreReclaimed) {
+  SnapshotMap<int, int> map;
+  epoch::collect();
+  for (int i = 0; i < 10; i++) {
+    map.insert(i, i);
+    EXPECT_EQ(epoch::pending(), 0);
+  }
+  {
+    auto view = map.view();
+    for (int i = 10; i < 13; i++) {
+      map.insert(i, i);
+    }
+    EXPECT_EQ(epoch::pending(), 3);
+  }
+  map.insert(13, 13);
+  EXPECT_EQ(epoch::pending(), 0);
+  EXPECT_EQ(map.len(), 14);
+}
+
+TEST(SnapshotMapTest, ReadersSeeWholeBatches) {
+  SnapshotMap<int, int> map;
+  const int keys = 64;
+  std::atomic<bool> done{ false };
+  std::thread writer([&]() {
+    for (int round = 0; round < 200; round++) {
+      map.update([&](auto& batch) {
+        for (int i = 0; i < keys; i++) {
+          batch.insert(i, round);
+        }
+        });
+    }
+    done.store(true);
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        auto view = map.view();
+        if (view.len() == 0) {
+          continue;
+        }
+        int round = *view.find(0);
+        for (int i = 0; i < keys; i++) {
+          EXPECT_EQ(*view.find(i), round);
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(map.get(keys - 1).value(), 199);
+}
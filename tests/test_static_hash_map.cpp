@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#define private public
+#include "../src/static_hash_map.h"
+
+using namespace dsun;
+
+namespace {
+  std::vector<std::pair<uint64_t, uint64_t>> random_items(size_t n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::pair<uint64_t, uint64_t>> items(n);
+    for (auto& item : items) {
+      item.first = rng() | 1;
+      item.second = rng();
+    }
+    return items;
+  }
+
+  // hashes every key to the same value
+  struct ConstantHash {
+    uint64_t operator()(uint64_t) const {
+      return 7;
+    }
+  };
+}
+
+TEST(StaticHashMapTest, FindsEveryKeyAndRejectsOthers) {
+  auto items = random_items(100000, 1);
+  auto map = StaticHashMap<uint64_t, uint64_t>::build(items, 1);
+  ASSERT_TRUE(map.has_value());
+  EXPECT_EQ(map->len(), items.size());
+  for (auto& [key, value] : items) {
+    const uint64_t* found = map->find(key);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(*found, value);
+  }
+  // the random keys are all odd
+  std::mt19937_64 rng(2);
+  for (int i = 0; i < 100000; i++) {
+    EXPECT_FALSE(map->contains_key(rng() & ~uint64_t(1)));
+  }
+}
+
+TEST(StaticHashMapTest, ThreeBitsPerKey) {
+  auto items = random_items(200000, 3);
+  auto map = StaticHashMap<uint64_t, uint64_t>::build(items);
+  ASSERT_TRUE(map.has_value());
+  EXPECT_LT(map->metadata_bits_per_key(), 3.01);
+  EXPECT_GT(map->metadata_bits_per_key(), 2.99);
+}
+
+TEST(StaticHashMapTest, PartitionsBuildInParallel) {
+  // a bit over two partitions' worth
+  auto items = random_items((size_t(1) << 21) + 1000, 4);
+  auto map = StaticHashMap<uint64_t, uint64_t>::build(items, 4);
+  ASSERT_TRUE(map.has_value());
+  EXPECT_EQ(map->partition_count_, 3);
+  for (auto& [key, value] : items) {
+    ASSERT_EQ(*map->find(key), value);
+  }
+  EXPECT_FALSE(map->contains_key(2));
+}
+
+TEST(StaticHashMapTest, DuplicateKeysKeepLastValue) {
+  std::vector<std::pair<std::string, int>> items = { {"a", 1}, {"b", 2}, {"a", 3}, {"c", 4}, {"b", 5} };
+  auto map = StaticHashMap<std::string, int>::build(items);
+  ASSERT_TRUE(map.has_value());
+  EXPECT_EQ(map->len(), 3);
+  EXPECT_EQ(*map->find("a"), 3);
+  EXPECT_EQ(*map->find("b"), 5);
+  EXPECT_EQ(*map->find("c"), 4);
+  EXPECT_FALSE(map->contains_key("d"));
+}
+
+TEST(StaticHashMapTest, HashCollisionFailsBuild) {
+  std::vector<std::pair<uint64_t, int>> items = { {1, 1}, {2, 2} };
+  EXPECT_FALSE((StaticHashMap<uint64_t, int, ConstantHash>::build(items).has_value()));
+  // the same key twice is a duplicate, not a collision
+  items[1].first = 1;
+  auto map = StaticHashMap<uint64_t, int, ConstantHash>::build(items);
+  ASSERT_TRUE(map.has_value());
+  EXPECT_EQ(*map->find(1), 2);
+}
+
+TEST(StaticHashMapTest, EmptyAndSingle) {
+  auto empty = StaticHashMap<uint64_t, uint64_t>::build({});
+  ASSERT_TRUE(empty.has_value());
+  EXPECT_EQ(empty->len(), 0);
+  EXPECT_FALSE(empty->contains_key(0));
+  std::vector<std::pair<uint64_t, uint64_t>> one = { {42, 1} };
+  auto single = StaticHashMap<uint64_t, uint64_t>::build(one);
+  ASSERT_TRUE(single.has_value());
+  EXPECT_EQ(*single->find(42), 1);
+  EXPECT_FALSE(single->contains_key(43));
+}
+
+TEST(StaticHashMapTest, SaveLoadAndMap) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_static_hash_map_test.bin").string();
+  auto items = random_items(50000, 5);
+  auto map = StaticHashMap<uint64_t, uint64_t>::build(items);
+  ASSERT_TRUE(map.has_value());
+  ASSERT_TRUE(map->save(path.c_str()));
+
+  auto loaded = StaticHashMap<uint64_t, uint64_t>::load(path.c_str());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_FALSE(loaded->is_mapped());
+  auto mapped = StaticHashMap<uint64_t, uint64_t>::open_mapped(path.c_str());
+  ASSERT_TRUE(mapped.has_value());
+  EXPECT_TRUE(mapped->is_mapped());
+  for (auto* copy : { &loaded.value(), &mapped.value() }) {
+    EXPECT_EQ(copy->len(), items.size());
+    for (auto& [key, value] : items) {
+      ASSERT_EQ(*copy->find(key), value);
+    }
+    EXPECT_FALSE(copy->contains_key(2));
+  }
+
+  // other value types and truncated files are rejected
+  EXPECT_FALSE((StaticHashMap<uint64_t, uint32_t>::open_mapped(path.c_str()).has_value()));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+  EXPECT_FALSE((StaticHashMap<uint64_t, uint64_t>::load(path.c_str()).has_value()));
+  std::filesystem::remove(path);
+}
+
+TEST(StaticHashMapTest, MoveLeavesSourceEmpty) {
+  std::string path = (std::filesystem::temp_directory_path() / "dsun_static_hash_map_move.bin").string();
+  auto items = random_items(1000, 9);
+  auto built = StaticHashMap<uint64_t, uint64_t>::build(items);
+  ASSERT_TRUE(built.has_value());
+  ASSERT_TRUE(built->save(path.c_str()));
+  auto mapped = StaticHashMap<uint64_t, uint64_t>::open_mapped(path.c_str());
+  ASSERT_TRUE(mapped.has_value());
+
+  for (auto* source : { &built.value(), &mapped.value() }) {
+    bool was_mapped = source->is_mapped();
+    std::optional<StaticHashMap<uint64_t, uint64_t>> target;
+    target.emplace(std::move(*source));
+    EXPECT_EQ(source->len(), 0);
+    EXPECT_FALSE(source->is_mapped());
+    EXPECT_EQ(source->find(items[0].first), nullptr);
+    EXPECT_EQ(target->is_mapped(), was_mapped);
+    for (auto& [key, value] : items) {
+      ASSERT_EQ(*target->find(key), value);
+    }
+    // assigning back leaves the moved-from target empty in turn
+    *source = std::move(*target);
+    EXPECT_EQ(target->len(), 0);
+    EXPECT_EQ(target->find(items[0].first), nullptr);
+    target.reset();
+    EXPECT_EQ(source->len(), items.size());
+    EXPECT_EQ(*source->find(items[1].first), items[1].second);
+  }
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#define private public
+#include "../src/unrolled_list.h"
+
+using namespace dsun;
+
+namespace {
+  // every chunk is at least half full, unless it is the only one
+  template <typename T, size_t B>
+  bool chunks_half_full(const UnrolledList<T, B>& list) {
+    if (list.chunk_count() <= 1) {
+      return true;
+    }
+    for (auto* chunk = list.head; chunk != nullptr; chunk = chunk->next) {
+      if (chunk->count < B / 2) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+TEST(UnrolledListInitTest, FromListTest) {
+  auto list = UnrolledList<int, 4>::from_list({ 1, 2, 3, 4, 5 });
+  ASSERT_EQ(list.len(), 5);
+  EXPECT_EQ(list.chunk_count(), 2);
+  for (int i = 1; i <= 5; ++i) {
+    auto value = list.pop_front();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value.value(), i);
+  }
+  EXPECT_EQ(list.chunk_count(), 0);
+}
+
+TEST(UnrolledListInitTest, Copy) {
+  auto list1 = UnrolledList<int, 4>::from_list({ 1, 2, 3 });
+  auto list2 = UnrolledList<int, 4>::from_list({ 4, 5, 6, 7, 8, 9 });
+
+  list1 = list2;
+  list2[0] = 40;
+  ASSERT_EQ(list1.len(), 6);
+  EXPECT_EQ(list1[0], 4);
+  for (size_t i = 1; i < 6; ++i) {
+    EXPECT_EQ(list1[i], list2[i]);
+  }
+}
+
+class UnrolledListTest : public ::testing::Test {
+protected:
+  UnrolledList<int, 4> list;
+};
+
+TEST_F(UnrolledListTest, PushAndPop) {
+  list.push_back(10);
+  list.push_back(20);
+  list.push_front(5);
+  EXPECT_EQ(list.len(), 3);
+  EXPECT_EQ(list.front().value(), 5);
+  EXPECT_EQ(list.back().value(), 20);
+  EXPECT_EQ(list.pop_back().value(), 20);
+  EXPECT_EQ(list.pop_front().value(), 5);
+  EXPECT_EQ(list.pop_front().value(), 10);
+  EXPECT_FALSE(list.pop_front().has_value());
+  EXPECT_FALSE(list.pop_back().has_value());
+}
+
+TEST_F(UnrolledListTest, PushFrontFillsNewChunks) {
+  for (int i = 0; i < 10; ++i) {
+    list.push_front(i);
+  }
+  EXPECT_EQ(list.chunk_count(), 3);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(list[i], 9 - i);
+  }
+}
+
+TEST_F(UnrolledListTest, At) {
+  list.push_back(10);
+  list.push_back(20);
+  list.push_back(30);
+
+  EXPECT_EQ(list.at(0).value(), 10);
+  EXPECT_EQ(list.at(1).value(), 20);
+  EXPECT_EQ(list.at(2).value(), 30);
+  EXPECT_FALSE(list.at(3).has_value());
+}
+
+TEST_F(UnrolledListTest, AtMut) {
+  list.push_back(10);
+  list.push_back(20);
+
+  *list.at_mut(1).value() = 25;
+  EXPECT_EQ(list.at(1).value(), 25);
+  EXPECT_FALSE(list.at_mut(2).has_value());
+}
+
+TEST_F(UnrolledListTest, OperatorIndexOutOfRange) {
+  list.push_back(10);
+  EXPECT_THROW(list[1], std::out_of_range);
+}
+
+TEST_F(UnrolledListTest, InsertSplitsFullChunk) {
+  for (int i = 0; i < 4; ++i) {
+    list.push_back(i * 10);
+  }
+  EXPECT_EQ(list.chunk_count(), 1);
+  list.insert(1, 5);
+  EXPECT_EQ(list.chunk_count(), 2);
+  list.insert(4, 25);
+
+  int expected[] = { 0, 5, 10, 20, 25, 30 };
+  ASSERT_EQ(list.len(), 6);
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_EQ(list[i], expected[i]);
+  }
+}
+
+TEST_F(UnrolledListTest, InsertAtEnds) {
+  list.insert(0, 10);
+  list.insert(0, 5);
+  list.insert(2, 15);
+  EXPECT_EQ(list[0], 5);
+  EXPECT_EQ(list[1], 10);
+  EXPECT_EQ(list[2], 15);
+}
+
+TEST_F(UnrolledListTest, InsertOutBounds) {
+  EXPECT_THROW(list.insert(1, 10), std::out_of_range);
+}
+
+TEST_F(UnrolledListTest, RemoveMergesUnderflowingChunks) {
+  for (int i = 0; i < 8; ++i) {
+    list.push_back(i);
+  }
+  EXPECT_EQ(list.chunk_count(), 2);
+  EXPECT_EQ(list.remove(1), 1);
+  EXPECT_EQ(list.remove(1), 2);
+  EXPECT_EQ(list.chunk_count(), 2);
+  EXPECT_EQ(list.remove(0), 0);
+  EXPECT_EQ(list.chunk_count(), 2);
+  EXPECT_EQ(list.remove(0), 3);
+  EXPECT_EQ(list.chunk_count(), 1);
+
+  int expected[] = { 4, 5, 6, 7 };
+  ASSERT_EQ(list.len(), 4);
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(list[i], expected[i]);
+  }
+}
+
+TEST_F(UnrolledListTest, RemoveOutOfBounds) {
+  EXPECT_THROW(list.remove(0), std::out_of_range);
+}
+
+TEST_F(UnrolledListTest, RemoveUntilEmpty) {
+  for (int i = 0; i < 9; ++i) {
+    list.push_back(i);
+  }
+  while (!list.is_empty()) {
+    list.remove(list.len() / 2);
+  }
+  EXPECT_EQ(list.chunk_count(), 0);
+  list.push_back(1);
+  EXPECT_EQ(list.front().value(), 1);
+}
+
+TEST(UnrolledListPopTest, KeepsChunksHalfFull) {
+  UnrolledList<int, 8> list;
+  for (int i = 0; i < 64; ++i) {
+    list.push_back(i);
+  }
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(list.pop_back().value(), 63 - i);
+    ASSERT_TRUE(chunks_half_full(list)) << i;
+  }
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(list.pop_front().value(), i);
+    ASSERT_TRUE(chunks_half_full(list)) << i;
+  }
+  // 24 elements left, packed into chunks of at least 4
+  EXPECT_LE(list.chunk_count(), 6);
+  for (int i = 20; !list.is_empty(); ++i) {
+    EXPECT_EQ(list.pop_front().value(), i);
+    ASSERT_TRUE(chunks_half_full(list));
+  }
+  EXPECT_EQ(list.chunk_count(), 0);
+}
+
+TEST(UnrolledListIteratorTest, Next) {
+  auto list = UnrolledList<int, 4>::from_list({ 10, 20, 30, 40, 50, 60, 70 });
+  size_t count = 0;
+  for (auto it = list.begin(); it.has_next(); ++it) {
+    EXPECT_EQ(*it, it.index() * 10 + 10);
+    count++;
+  }
+  EXPECT_EQ(count, 7);
+}
+
+TEST(UnrolledListIteratorTest, GetMut) {
+  auto list = UnrolledList<int, 4>::from_list({ 10, 20, 30, 40, 50 });
+  for (auto it = list.begin(); it != list.end(); ++it) {
+    it.get_mut() = 7;
+  }
+  for (auto value : list) {
+    EXPECT_EQ(value, 7);
+  }
+}
+
+TEST(UnrolledListStressTest, MatchesReferenceOnMiddleEdits) {
+  UnrolledList<std::string, 8> list;
+  std::vector<std::string> reference;
+  uint32_t seed = 7;
+  for (int i = 0; i < 2000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    size_t at = reference.empty() ? 0 : seed % (reference.size() + 1);
+    if (seed % 3 != 0 || reference.empty()) {
+      list.insert(at, std::to_string(i));
+      reference.insert(reference.begin() + at, std::to_string(i));
+    }
+    else {
+      at = at % reference.size();
+      EXPECT_EQ(list.remove(at), reference[at]);
+      reference.erase(reference.begin() + at);
+    }
+  }
+  ASSERT_EQ(list.len(), reference.size());
+  size_t i = 0;
+  for (auto value : list) {
+    EXPECT_EQ(value, reference[i++]);
+  }
+  EXPECT_LE(list.chunk_count(), reference.size() / 4 + 2);
+}
+
+namespace {
+  // copies throw while `fail` is set
+  struct Fragile {
+    static inline bool fail = false;
+    int value;
+    explicit Fragile(int value) : value(value) {}
+    Fragile(const Fragile& other) : value(other.value) {
+      if (fail) {
+        throw std::runtime_error("copy failed");
+      }
+    }
+    Fragile(Fragile&&) noexcept = default;
+    Fragile& operator=(const Fragile&) = default;
+    Fragile& operator=(Fragile&&) noexcept = default;
+  };
+}
+
+TEST(UnrolledListPushTest, ThrowingCopyLeavesNoEmptyChunk) {
+  UnrolledList<Fragile, 4> list;
+  for (int i = 0; i < 4; ++i) {
+    list.push_back(Fragile(i));
+  }
+  Fragile::fail = true;
+  EXPECT_THROW(list.push_back(Fragile(4)), std::runtime_error);
+  EXPECT_THROW(list.push_front(Fragile(-1)), std::runtime_error);
+  Fragile::fail = false;
+  EXPECT_EQ(list.len(), 4);
+  EXPECT_EQ(list.chunk_count(), 1);
+  for (int i = 3; i >= 0; --i) {
+    EXPECT_EQ(list.pop_back()->value, i);
+  }
+  EXPECT_EQ(list.chunk_count(), 0);
+}